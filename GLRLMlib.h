@@ -0,0 +1,222 @@
+/* Gray level run length matrix (GLRLM) features
+ * Include after PGMlib.h and Haralicklib.h
+ *
+ * R(i,l) = no of runs of l consecutive pixels of gray level i along the
+ * run direction. The features are
+ *   SRE = (sigma i,l) R(i,l)/l^2 / Nr       short run emphasis
+ *   LRE = (sigma i,l) R(i,l)*l^2 / Nr       long run emphasis
+ *   GLN = (sigma i)((sigma l) R(i,l))^2 / Nr gray level non-uniformity
+ *   RLN = (sigma l)((sigma i) R(i,l))^2 / Nr run length non-uniformity
+ *   RP  = Nr / Np                           run percentage
+ * with Nr the no of runs and Np the no of pixels.
+ */
+
+/* Structure of a run length matrix */
+typedef struct _GLRLM
+{
+    int max_gray;       // no of gray levels
+    int max_run;        // longest run that fits the image
+    unsigned int **R;   // max_gray x max_run, R[i][l-1] counts runs of length l
+    long long n_pixels; // no of pixels in the runs
+}GLRLM;
+
+void init_glrlm(GLRLM *M, int max_gray, int max_run)
+{
+    int i, l;
+    M->max_gray = max_gray;
+    M->max_run = max_run;
+    M->n_pixels = 0;
+    M->R = allocate_dynamic_matrix_uint(max_gray, max_run);
+    for(i=0;i<max_gray;i++)
+    	for(l=0;l<max_run;l++)
+    		M->R[i][l]=0;
+}
+
+void free_glrlm(GLRLM *M)
+{
+    deallocate_dynamic_matrix_uint(M->R, M->max_gray);
+    M->R = NULL;
+}
+
+/* Map from pixel to the line of runs it lies on
+ * line = kx*x + ky*y + k0, so consecutive pixels of a line are met in
+ * order by a row-major scan for each of the four directions
+ */
+typedef struct _RunLines
+{
+    int kx, ky, k0;
+    int n_lines;
+    int max_run;
+}RunLines;
+
+RunLines make_run_lines(int angle, int width, int height)
+{
+    RunLines r;
+    switch(angle)
+    {
+    	case 0: r.kx=1; r.ky=0; r.k0=0; r.n_lines=width; r.max_run=height; break;
+    	case 90: r.kx=0; r.ky=1; r.k0=0; r.n_lines=height; r.max_run=width; break;
+    	case 45: r.kx=1; r.ky=1; r.k0=0; r.n_lines=width+height-1; r.max_run=(width<height)? width:height; break;
+    	case 135: r.kx=1; r.ky=-1; r.k0=height-1; r.n_lines=width+height-1; r.max_run=(width<height)? width:height; break;
+    	default:
+    		fprintf(stderr, "Run length angle must be 0, 45, 90 or 135!\n");
+    		exit(1);
+    }
+    return r;
+}
+
+/* To fill the co-occurance counts and the run length matrix in one scan
+ * Each row is loaded once: its co-occurance pairs are counted and then
+ * its pixels extend the open run of their line, while the row is still
+ * in cache. A run is closed when its line changes gray level or at the end.
+ * Arguments: data: The PGM image
+ *            delx, dely: The displacement of the co-occurance neighbour
+ *            run_angle: Direction of the runs, 0, 45, 90 or 135
+ *            C: max_gray x max_gray matrix to store the counts into
+ *            M: Run length matrix from init_glrlm, sized by make_run_lines
+ */
+void fill_cooccurance_and_run_length(PGMData *data, int delx, int dely, int run_angle, unsigned int **C, GLRLM *M)
+{
+    int x, y, a, b, k;
+    int G = data->max_gray;
+    GLCMOffset o = make_glcm_offset(delx, dely, data->width, data->height);
+    RunLines r = make_run_lines(run_angle, data->width, data->height);
+    int *run_gray = (int *)malloc(sizeof(int) * r.n_lines);
+    int *run_len = (int *)malloc(sizeof(int) * r.n_lines);
+    if (run_gray == NULL || run_len == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+    for(k=0;k<r.n_lines;k++)
+    {
+    	run_gray[k]=-1;
+    	run_len[k]=0;
+    }
+    for(a=0;a<G;a++)
+    	for(b=0;b<G;b++)
+    		C[a][b]=0;
+
+    for(x=0;x<data->width;x++)
+    {
+    	int *row = data->pixels[x];
+    	if(x >= o.xlo && x < o.xhi)
+    	{
+    		int *next = data->pixels[x+delx] + dely;
+    		for(y=o.ylo;y<o.yhi;y++)
+    		{
+    			a = row[y];
+    			b = next[y];
+    			if((unsigned)a < (unsigned)G && (unsigned)b < (unsigned)G)
+    				C[a][b]++;
+    		}
+    	}
+    	k = r.kx*x + r.k0;
+    	for(y=0;y<data->height;y++, k+=r.ky)
+    	{
+    		a = row[y];
+    		if(a == run_gray[k])
+    		{
+    			run_len[k]++;
+    			continue;
+    		}
+    		if(run_gray[k] >= 0)
+    			M->R[run_gray[k]][run_len[k]-1]++;
+    		if((unsigned)a < (unsigned)G)
+    		{
+    			run_gray[k] = a;
+    			run_len[k] = 1;
+    		}
+    		else
+    			run_gray[k] = -1;
+    	}
+    }
+    for(k=0;k<r.n_lines;k++)
+    	if(run_gray[k] >= 0)
+    		M->R[run_gray[k]][run_len[k]-1]++;
+
+    M->n_pixels = 0;
+    for(a=0;a<G;a++)
+    	for(k=0;k<M->max_run;k++)
+    		M->n_pixels += (long long)M->R[a][k]*(k+1);
+
+    free(run_gray);
+    free(run_len);
+}
+
+/* To calculate the run length features
+ * Arguments: M: The run length matrix
+ *            fr: SRE, LRE, GLN, RLN and RP, in that order
+ */
+double *calculate_glrlm_parameters(GLRLM *M, double fr[5])
+{
+    int i, l;
+    double n_runs=0, sre=0, lre=0, gln=0, rln=0, row_sum, len;
+    double *col_sum = (double *)calloc(M->max_run, sizeof(double));
+    if (col_sum == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+
+    for(i=0;i<M->max_gray;i++)
+    {
+    	row_sum=0;
+    	for(l=0;l<M->max_run;l++)
+    	{
+    		double c = M->R[i][l];
+    		if(c == 0)
+    			continue;
+    		len = l+1;
+    		sre += c/(len*len);
+    		lre += c*len*len;
+    		row_sum += c;
+    		col_sum[l] += c;
+    	}
+    	gln += row_sum*row_sum;
+    	n_runs += row_sum;
+    }
+    for(l=0;l<M->max_run;l++)
+    	rln += col_sum[l]*col_sum[l];
+    free(col_sum);
+
+    if(n_runs == 0)
+    {
+    	fr[0]=fr[1]=fr[2]=fr[3]=fr[4]=0;
+    	return fr;
+    }
+    fr[0] = sre/n_runs;
+    fr[1] = lre/n_runs;
+    fr[2] = gln/n_runs;
+    fr[3] = rln/n_runs;
+    fr[4] = n_runs/(double)M->n_pixels;
+    return fr;
+}
+
+/* To find the Haralick and run length features of an image in one pass
+ * The runs follow the same direction as the co-occurance config
+ * Arguements: data: The PGM image
+ *             delta: The distance
+ *             angle: The config in degrees, 0, 45, 90 or 135
+ *             f: The 13 Haralick parameters
+ *             fr: The 5 run length parameters
+ */
+void create_cooccurance_and_run_length(PGMData *data, int delta, int angle, double f[13], double fr[5])
+{
+    int delx, dely;
+    HaralickScratch s;
+    GLRLM M;
+    unsigned int **C;
+    RunLines r = make_run_lines(angle, data->width, data->height);
+    angle_to_displacement(delta, angle, &delx, &dely);
+
+    C = allocate_dynamic_matrix_uint(data->max_gray, data->max_gray);
+    init_glrlm(&M, data->max_gray, r.max_run);
+    init_haralick_scratch(&s, data->max_gray);
+    fill_cooccurance_and_run_length(data, delx, dely, angle, C, &M);
+    calculate_haralick_parameters_counts(C, data->max_gray, f, &s);
+    calculate_glrlm_parameters(&M, fr);
+    free_haralick_scratch(&s);
+    free_glrlm(&M);
+    deallocate_dynamic_matrix_uint(C, data->max_gray);
+}
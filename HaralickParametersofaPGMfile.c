@@ -332,6 +332,84 @@ void printPGM(PGMData picture)
 	    }
 }
 
+/* To find the maximal correlation coefficient (f14) of a normalised matrix
+ * f14 is the square root of the second largest eigenvalue of
+ * Q(i,j) = sum_k P(i,k)P(j,k)/(Px(i)Py(k)). Q has the same eigenvalues as
+ * the symmetric B*transpose(B), B(i,k) = P(i,k)/sqrt(Px(i)Py(k)), whose
+ * largest eigenvalue is 1 with eigenvector sqrt(Px). The second one is found
+ * by power iteration kept orthogonal to sqrt(Px); Q is never formed, each
+ * step is two O(mn) row-major products with B.
+ * Arguments: P: The normalised cooccurance matrix
+ *            m, n: No of rows and columns of P
+ *            Px, Py: Its marginals
+ *            work: 2m+n doubles of scratch
+ */
+double maximal_correlation_coefficient(double **P, int m, int n, double *Px, double *Py, double *work)
+{
+    double *v = work, *rx = work+m, *t = work+2*m;
+    double lambda = 0, prev = -1, norm, dot;
+    int i, k, iter;
+
+    for(i=0; i<m; i++)
+    {
+    	rx[i] = (Px[i]>0)? 1/sqrt(Px[i]):0;
+    	v[i] = (Px[i]>0)? 1+i:0;
+    }
+
+    for(iter=0; iter<500; iter++)
+    {
+    	/* Remove the sqrt(Px) component and normalise */
+    	dot = 0;
+    	for(i=0; i<m; i++)
+    		dot = dot + v[i]*sqrt(Px[i]);
+    	norm = 0;
+    	for(i=0; i<m; i++)
+    	{
+    		v[i] = v[i] - dot*sqrt(Px[i]);
+    		norm = norm + v[i]*v[i];
+    	}
+    	if(norm <= 0)
+    		return 0;
+    	norm = sqrt(norm);
+    	for(i=0; i<m; i++)
+    		v[i] = v[i]/norm;
+
+    	/* t = transpose(B) v */
+    	for(k=0; k<n; k++)
+    		t[k] = 0;
+    	for(i=0; i<m; i++)
+    	{
+    		double *row = P[i];
+    		double a = v[i]*rx[i];
+    		if(a == 0) continue;
+    		for(k=0; k<n; k++)
+    			t[k] = t[k] + a*row[k];
+    	}
+    	for(k=0; k<n; k++)
+    		t[k] = (Py[k]>0)? t[k]/Py[k]:0;
+
+    	/* v = B t, lambda = old v . new v */
+    	lambda = 0;
+    	for(i=0; i<m; i++)
+    	{
+    		double *row = P[i];
+    		double z = 0;
+    		if(rx[i] == 0) continue;
+    		for(k=0; k<n; k++)
+    			z = z + row[k]*t[k];
+    		z = z*rx[i];
+    		lambda = lambda + v[i]*z;
+    		v[i] = z;
+    	}
+
+    	if(fabs(lambda-prev) <= 0.000000000001*(1+lambda))
+    		break;
+    	prev = lambda;
+    }
+
+    return (lambda>0)? sqrt(lambda):0;
+}
+
 double *calculate_harlick_parameters(double **P, int data_max_gray, double *fx)
 {
 
@@ -354,7 +432,7 @@ double *calculate_harlick_parameters(double **P, int data_max_gray, double *fx)
     	}
     }
 
-    printf("N = %f\tmax gray = %d\n",N,data_max_gray);
+//    printf("N = %f\tmax gray = %d\n",N,data_max_gray);
     double Px[1024], Py[1024], ux, uy,u, sx, sy, Pxplusy[2048], Pxminusy[2048];
 /*
     Px = allocate_dynamic_matrix_a(data_max_gray);
@@ -416,8 +494,6 @@ double *calculate_harlick_parameters(double **P, int data_max_gray, double *fx)
 
 
     double HXY1, HXY2, HX=0, HY=0;
-    double **Q;
-    Q = allocate_dynamic_matrix_d((data_max_gray), (data_max_gray));
     for(i=0; i<data_max_gray; i++)
     {
         if(Px[i]>0)
@@ -437,17 +513,11 @@ double *calculate_harlick_parameters(double **P, int data_max_gray, double *fx)
        		    HXY1 = HXY1 - P[i][j]*log(Px[i]*Py[j]);
          	if(Px[i]*Py[j]!=0)
          		HXY2 = HXY2 - Px[i]*Py[j]*log(Px[i]*Py[j]);
-
-         	Q[i][j]=0;
-         	for(k=0;k<data_max_gray;k++)
-         		if(Px[i]*Py[j]!=0)
-         		Q[i][j] = Q[i][j]+ P[i][k]*P[j][k]/(Px[i]*Py[j]);
          }
      }
 
-       printf("ux = %g\tuy = %g\tsx = %g\tsy=%g\n",ux,uy,sx,sy);
-       printf("HXY1 = %g\tHXY2 = %g\tHX = %g\tHY = %g\n",HXY1,HXY2,HX,HY);
-    printf("u = %f\n",u);
+//    printf("ux = %g\tuy = %g\tsx = %g\tsy=%g\n",ux,uy,sx,sy);
+//    printf("HXY1 = %g\tHXY2 = %g\tHX = %g\tHY = %g\n",HXY1,HXY2,HX,HY);
 
     for(i=0; i<14; i++)
         fx[i]=0;
@@ -507,20 +577,47 @@ double *calculate_harlick_parameters(double **P, int data_max_gray, double *fx)
     fx[11] = (fx[8]-HXY1)/t;
     fx[12] = sqrt(1-exp(-2*(HXY2 - fx[8])));
 
-    printf("The Q thing\n");
-	for(i=0; i<data_max_gray; i++)
-    	{
-    		for(j=0; j<data_max_gray; j++)
-    		{
-    printf("%f\t\t",Q[i][j]);		}
-    	printf("\n");}
-
+    double work[3*1024];
+    fx[13] = maximal_correlation_coefficient(P, data_max_gray, data_max_gray, Px, Py, work);
 
     return fx;
 
 }
 
 
+/* To fill the co-occurance matrix in a single scan over the image
+ * Every pixel (x,y) whose neighbour (x+delx,y+dely) lies inside the image
+ * adds one to P[I(x,y)][I(x+delx,y+dely)]. Gray values outside
+ * 0..max_gray-1 are not counted.
+ * Arguments: data: The PGM image
+ *            delx, dely: The displacement of the neighbour
+ *            P: max_gray x max_gray matrix to store the counts into
+ */
+void fill_cooccurance_matrix(PGMData *data, int delx, int dely, double **P)
+{
+    int i, j, x, y, a, b;
+    int G = data->max_gray;
+    int xlo = (delx < 0)? -delx:0, xhi = (delx > 0)? data->width-delx:data->width;
+    int ylo = (dely < 0)? -dely:0, yhi = (dely > 0)? data->height-dely:data->height;
+
+    for(i=0;i<G;i++)
+    	for(j=0;j<G;j++)
+    		P[i][j]=0;
+
+    for(x=xlo;x<xhi;x++)
+    {
+    	int *row = data->pixels[x];
+    	int *next = data->pixels[x+delx] + dely;
+    	for(y=ylo;y<yhi;y++)
+    	{
+    		a = row[y];
+    		b = next[y];
+    		if((unsigned)a < (unsigned)G && (unsigned)b < (unsigned)G)
+    			P[a][b]=P[a][b]+1;
+    	}
+    }
+}
+
 /* To create co-occurance matrix */
 void create_cooccurance_matrix(PGMData *data, int delta, int angle)
 {
@@ -551,31 +648,9 @@ void create_cooccurance_matrix(PGMData *data, int delta, int angle)
     double **P;
     P = allocate_dynamic_matrix_d((data->max_gray), (data->max_gray));
 
-    int i,j,x,y;
-
-    for(i=0;i<data->max_gray;i++)
-    	for(j=0;j<data->max_gray;j++)
-    		P[i][j]=0;
+    int i;
 
-    int temp1, temp2;
-    for(i=0;i<data->max_gray;i++)
-    {
-    	for(j=0;j<data->max_gray;j++)
-    	{
-    		for(x=0;x<data->width;x++)
-    		{
-    			for(y=0;y<data->height;y++)
-    			{
-                    temp1 = (x+delx >= 0)? x+delx:-1;
-                    temp2 = (y+dely >= 0)? y+dely:-1;
-                    if(temp1>=0 && temp2 >=0)
-                                /* Uncomment rest of line and remove last closing bracket  |  to get symmetrical matrix*/ 
-    				if((data->pixels[x][y]==i && data->pixels[temp1][temp2]==j))//|| (data->pixels[x][y]==j && data->pixels[temp1][temp2]==i))
-    				    P[i][j]=P[i][j]+1;
-    			}
-    		}
-    	}
-    }
+    fill_cooccurance_matrix(data, delx, dely, P);
     deallocate_dynamic_matrix(data->pixels, data->width);
     /*
     printf("\nPRINTING COOCCURANCE MATRIX with theta = %d\n",angle);
@@ -593,7 +668,7 @@ void create_cooccurance_matrix(PGMData *data, int delta, int angle)
     calculate_harlick_parameters(P,data->max_gray,f);
 
     printf("HARLICKs PARAMETERS\n");
-    for(i=0; i<13; i++)
+    for(i=0; i<14; i++)
     {
     	printf("f%d = %g\t\t",i+1, f[i]);
     	if(i%3==2) printf("\n");
@@ -6,231 +6,468 @@
 
 
 #include <math.h>
-/* Function to calculate Haralick parameters from the concurrence matrix
- * Argurments: P: The cooccurance matrix
- *             data_max_gray: max gray value
- *             fx: The array to store the result*/
-double *calculate_haralick_parameters(double **P, int data_max_gray, double fx[13])
+#include <pthread.h>
+/* Scratch space for the marginals of the Haralick kernel
+ * Px, Py, Pxplusy and Pxminusy live in one heap block sized to the gray
+ * levels. A worker keeps one of these and passes it to every call, so a
+ * batch only allocates when it meets a larger matrix than before.
+ */
+typedef struct _HaralickScratch
 {
-
-//	printf("Calculating Haralick parameters\n");
-    /*Normalise the matrix*/
-	double N=0;
-    int i,j,k;
-    for(i=0;i<data_max_gray;i++)
+    int m, n;           // largest no of rows and columns the block fits
+    double *block;      // The single allocation
+    double *Px;         // m entries
+    double *Py;         // n entries
+    double *Pxplusy;    // m+n-1 entries
+    double *Pxminusy;   // m+n-1 entries
+    double *work;       // 2m+n entries for the f14 power iteration
+    double *clogc;      // c*log(c) for small counts, built on first use
+}HaralickScratch;
+
+/* No of counts whose c*log(c) is kept in the scratch table */
+#define CLOGC_TABLE_SIZE 4096
+
+/* To make sure the scratch fits a m x n matrix, growing it if needed */
+void reserve_haralick_scratch(HaralickScratch *s, int m, int n)
+{
+    if(s->block != NULL && m <= s->m && n <= s->n)
+    	return;
+    if(s->m > m) m = s->m;
+    if(s->n > n) n = s->n;
+
+    free(s->block);
+    s->block = (double *)malloc(sizeof(double) * (m + n + 2*(m+n-1) + 2*m+n));
+    if (s->block == NULL)
     {
-    	for(j=0;j<data_max_gray;j++)
-    	{
-    		N = N + P[i][j];
-    	}
+        perror("Memory allocation failure");
+        exit(1);
     }
-    for(i=0;i<data_max_gray;i++)
-    {
-    	for(j=0;j<data_max_gray;j++)
-    	{
-    		P[i][j] = P[i][j]/N;
+    s->m = m;
+    s->n = n;
+    s->Px = s->block;
+    s->Py = s->Px + m;
+    s->Pxplusy = s->Py + n;
+    s->Pxminusy = s->Pxplusy + (m+n-1);
+    s->work = s->Pxminusy + (m+n-1);
+}
 
-    	}
+/* To allocate the scratch for max_gray x max_gray matrices
+ * With max_gray = 0 nothing is allocated until the first call needs it
+ */
+void init_haralick_scratch(HaralickScratch *s, int max_gray)
+{
+    s->m = 0;
+    s->n = 0;
+    s->block = NULL;
+    s->Px = s->Py = s->Pxplusy = s->Pxminusy = s->work = NULL;
+    s->clogc = NULL;
+    if(max_gray > 0)
+    	reserve_haralick_scratch(s, max_gray, max_gray);
+}
 
-    }
-//    printf("N = %f\tmax gray = %d\n",N,data_max_gray);
-    double Px[17000], Py[17000], ux, uy,u, sx, sy, Pxplusy[33000], Pxminusy[33000];
+void free_haralick_scratch(HaralickScratch *s)
+{
+    free(s->block);
+    free(s->clogc);
+    s->block = NULL;
+    s->clogc = NULL;
+    s->m = 0;
+    s->n = 0;
+}
 
-    for(i=0; i<data_max_gray; i++)
-    {
-    	Px[i]=0;
-       	Py[i]=0;
-       	for(j=0; j<data_max_gray; j++)
-       	{
-       		Px[i] = Px[i]+P[i][j];
-       		Py[i] = Py[i]+P[j][i];
-       	}
-    }
+/* Bits of the feature mask selecting which Haralick parameters to compute
+ * HARALICK_F(1) is f1 (fx[0]) ... HARALICK_F(14) is f14 (fx[13]).
+ * HARALICK_ALL is f1..f13; fx needs 14 entries when f14 is asked for.
+ */
+#define HARALICK_F(n) (1u << ((n)-1))
+#define HARALICK_ALL  0x1FFFu
+
+/* To find the maximal correlation coefficient (f14) of a normalised matrix
+ * f14 is the square root of the second largest eigenvalue of
+ * Q(i,j) = sum_k P(i,k)P(j,k)/(Px(i)Py(k)). Q has the same eigenvalues as
+ * the symmetric B*transpose(B), B(i,k) = P(i,k)/sqrt(Px(i)Py(k)), whose
+ * largest eigenvalue is 1 with eigenvector sqrt(Px). The second one is found
+ * by power iteration kept orthogonal to sqrt(Px); Q is never formed, each
+ * step is two O(mn) row-major products with B.
+ * Arguments: P: The normalised cooccurance matrix
+ *            m, n: No of rows and columns of P
+ *            Px, Py: Its marginals
+ *            work: 2m+n doubles of scratch
+ */
+double maximal_correlation_coefficient(double **P, int m, int n, double *Px, double *Py, double *work)
+{
+    double *v = work, *rx = work+m, *t = work+2*m;
+    double lambda = 0, prev = -1, norm, dot;
+    int i, k, iter;
 
-    ux=0; uy=0, u=0;
-    for(i=0;i<data_max_gray;i++)
+    for(i=0; i<m; i++)
     {
-      	ux = ux + i*Px[i];
-       	uy = uy + i*Py[i];
+    	rx[i] = (Px[i]>0)? 1/sqrt(Px[i]):0;
+    	v[i] = (Px[i]>0)? 1+i:0;
     }
 
-    for(k=0; k<2*data_max_gray-1; k++)
+    for(iter=0; iter<500; iter++)
     {
-       	Pxplusy[k]=0;
-       	Pxminusy[k]=0;
-    }
-
+    	/* Remove the sqrt(Px) component and normalise */
+    	dot = 0;
+    	for(i=0; i<m; i++)
+    		dot = dot + v[i]*sqrt(Px[i]);
+    	norm = 0;
+    	for(i=0; i<m; i++)
+    	{
+    		v[i] = v[i] - dot*sqrt(Px[i]);
+    		norm = norm + v[i]*v[i];
+    	}
+    	if(norm <= 0)
+    		return 0;
+    	norm = sqrt(norm);
+    	for(i=0; i<m; i++)
+    		v[i] = v[i]/norm;
 
+    	/* t = transpose(B) v */
+    	for(k=0; k<n; k++)
+    		t[k] = 0;
+    	for(i=0; i<m; i++)
+    	{
+    		double *row = P[i];
+    		double a = v[i]*rx[i];
+    		if(a == 0) continue;
+    		for(k=0; k<n; k++)
+    			t[k] = t[k] + a*row[k];
+    	}
+    	for(k=0; k<n; k++)
+    		t[k] = (Py[k]>0)? t[k]/Py[k]:0;
 
-    for(i=0; i<data_max_gray; i++)
-    {
-       	for(j=0; j<data_max_gray; j++)
-       	{
-       		Pxplusy[i+j] = Pxplusy[i+j]+P[i][j];
-       		if(i>=j)
-       			Pxminusy[i-j] = Pxminusy[i-j]+P[i][j];
-       		else
-       			Pxminusy[j-i] = Pxminusy[j-i]+P[i][j];
+    	/* v = B t, lambda = old v . new v */
+    	lambda = 0;
+    	for(i=0; i<m; i++)
+    	{
+    		double *row = P[i];
+    		double z = 0;
+    		if(rx[i] == 0) continue;
+    		for(k=0; k<n; k++)
+    			z = z + row[k]*t[k];
+    		z = z*rx[i];
+    		lambda = lambda + v[i]*z;
+    		v[i] = z;
+    	}
 
-      	}
+    	if(fabs(lambda-prev) <= 0.000000000001*(1+lambda))
+    		break;
+    	prev = lambda;
     }
 
-    u = 0.5* ux+ 0.5*uy;
+    return (lambda>0)? sqrt(lambda):0;
+}
+
+/* Kernel computing the Haralick parameters of a m x n cooccurance matrix
+ * P is read in up to three fused passes (sum, normalise + marginals,
+ * HXY1/HXY2); every other parameter comes from the O(G) marginals Px, Py,
+ * Pxplusy and Pxminusy. Only the intermediates of the parameters in mask are
+ * computed: the entropy logs are skipped unless f9, f12 or f13 is asked for,
+ * the HXY pass unless f12 or f13 is. Parameters not in mask are set to 0.
+ * f14 (maximal correlation coefficient) is only computed when asked for.
+ * The values are those of the original nested loop formulation:
+ * f2 (contrast) sums only i>=j and f11 is scaled by n.
+ * Arguments: P: The cooccurance matrix, normalised in place
+ *            m, n: No of rows and columns of P
+ *            mask: HARALICK_F bits of the parameters wanted
+ *            fx: The array to store the result (14 entries if f14 is wanted)
+ *            s: Scratch for the marginals, grown to m x n if needed
+ */
+double *haralick_kernel(double **P, int m, int n, unsigned int mask, double *fx, HaralickScratch *s)
+{
+    double N=0;
+    int i,j;
+    double ux, uy, u, sx, sy;
+    int want_hxy = (mask & (HARALICK_F(12) | HARALICK_F(13))) != 0;
+    int want_entropy = want_hxy || (mask & HARALICK_F(9));
+    int want_sum = (mask & (HARALICK_F(6) | HARALICK_F(7) | HARALICK_F(8))) != 0;
+    int want_diff = (mask & (HARALICK_F(10) | HARALICK_F(11))) != 0;
+    int want_marginals = want_hxy || (mask & (HARALICK_F(3) | HARALICK_F(4)));
+
+    reserve_haralick_scratch(s, m, n);
+    double *Px = s->Px, *Py = s->Py, *Pxplusy = s->Pxplusy, *Pxminusy = s->Pxminusy;
 
-    sx = 0; sy = 0;
-    for(i=0; i<data_max_gray; i++)
+    for(i=0;i<m;i++)
     {
-      	sx = sx+Px[i]*(i-ux)*(i-ux);
-       	sy = sy+Py[i]*(i-uy)*(i-uy);
+    	double *row = P[i];
+    	for(j=0;j<n;j++)
+    		N = N + row[j];
     }
 
-
-    sx = sqrt(sx);
-    sy = sqrt(sy);
-
-
-    double HXY1, HXY2, HX=0, HY=0;
-    for(i=0; i<data_max_gray; i++)
+    for(i=0; i<13; i++)
+        fx[i]=0;
+    for(j=0; j<n; j++)
+    	Py[j]=0;
+    for(i=0; i<m+n-1; i++)
     {
-        HX = HX - Px[i]*log(Px[i]+0.00000001);
-  	    HY = HY - Py[i]*log(Py[i]+0.00000001);
+    	Pxplusy[i]=0;
+    	Pxminusy[i]=0;
     }
 
-
-    HXY1 = 0; HXY2 = 0;
-    for(i=0; i<data_max_gray; i++)
+    /* Normalise the matrix and gather everything that needs only P[i][j] */
+    for(i=0; i<m; i++)
     {
-     	for(j=0; j<data_max_gray; j++)
-     	{
-   		    HXY1 = HXY1 - P[i][j]*log(Px[i]*Py[j] +0.00000001);
-            HXY2 = HXY2 - Px[i]*Py[j]*log(Px[i]*Py[j] +0.00000001);
-
-       	}
-   	}
-
-
+    	double *row = P[i];
+    	double px = 0;
+    	for(j=0; j<n; j++)
+    	{
+    		double p = row[j]/N;
+    		double k = i-j;
+    		row[j] = p;
+    		px = px + p;
+    		Py[j] = Py[j] + p;
+    		Pxplusy[i+j] = Pxplusy[i+j] + p;
+    		Pxminusy[(i>=j)? i-j:j-i] = Pxminusy[(i>=j)? i-j:j-i] + p;
+    		fx[0] = fx[0] + p*p;
+    		if(i>=j)
+    			fx[1] = fx[1] + p*k*k;
+    		fx[4] = fx[4] + p/(1+k*k);
+    		if(want_entropy)
+    			fx[8] = fx[8] - p*log(p+0.00000001);
+    	}
+    	Px[i] = px;
+    }
 
-//    printf("ux = %g\t\tuy = %g\t\tsx = %g\t\tsy=%g\t\tu = %f\n",ux,uy,sx,sy,u);
-//    printf("HXY1 = %g\t\tHXY2 = %g\t\tHX = %g\t\tHY = %g\n",HXY1,HXY2,HX,HY);
+    double HXY1=0, HXY2=0, HX=0, HY=0;
+    if(want_marginals)
+    {
+    	ux=0; uy=0;
+    	for(i=0; i<m; i++)
+    		ux = ux + i*Px[i];
+    	for(j=0; j<n; j++)
+    		uy = uy + j*Py[j];
+    	u = 0.5*ux + 0.5*uy;
 
+    	sx = 0; sy = 0;
+    	for(i=0; i<m; i++)
+    		sx = sx + Px[i]*(i-ux)*(i-ux);
+    	for(j=0; j<n; j++)
+    		sy = sy + Py[j]*(j-uy)*(j-uy);
+    	sx = sqrt(sx);
+    	sy = sqrt(sy);
 
-    for(i=0; i<14; i++)
-        fx[i]=0;
-    for(i=0; i<data_max_gray; i++)
-    {
-    	for(j=0;j<data_max_gray; j++)
+    	/* f3 and f4 only depend on the row index, so they reduce to sums over Px */
+    	for(i=0; i<m; i++)
     	{
-    		fx[0] = fx[0] + P[i][j]*P[i][j];
-    		fx[2] = fx[2] + (i-ux)*(i-uy)*P[i][j]/(sx*sy +0.00000001);
-    		fx[3] = fx[3] + (i-u)*(i-u)*P[i][j];
-    		fx[4] = fx[4] + P[i][j]/(1+(i-j)*(i-j));
-    		fx[8] = fx[8] - P[i][j]*log(P[i][j]+0.00000001);
-    		fx[10] = fx[10] - Pxminusy[i]*log(Pxminusy[i]+0.00000001);
+    		fx[2] = fx[2] + (i-ux)*(i-uy)*Px[i];
+    		fx[3] = fx[3] + (i-u)*(i-u)*Px[i];
     	}
+    	fx[2] = fx[2]/(sx*sy +0.00000001);
     }
 
-    for(k=0; k<data_max_gray; k++)
+    if(want_hxy)
     {
-    	for(i=0; i<data_max_gray; i++)
+    	for(i=0; i<m; i++)
+    		HX = HX - Px[i]*log(Px[i]+0.00000001);
+    	for(j=0; j<n; j++)
+    		HY = HY - Py[j]*log(Py[j]+0.00000001);
+
+    	for(i=0; i<m; i++)
     	{
-    		for(j=0; j<data_max_gray; j++)
+    		double *row = P[i];
+    		for(j=0; j<n; j++)
     		{
-    			if(i-j == k)
-    				fx[1]=fx[1]+ P[i][j]*k*k;
+    			double pxy = Px[i]*Py[j];
+    			double l = log(pxy +0.00000001);
+    			HXY1 = HXY1 - row[j]*l;
+    			HXY2 = HXY2 - pxy*l;
     		}
     	}
-    }
-
 
-    for(i=0; i<2*data_max_gray-1; i++)
-    {
-    	fx[5] = fx[5] + i*Pxplusy[i];
-    	fx[7] = fx[7] - Pxplusy[i]*log(Pxplusy[i]+0.00000001);
+    	double t;
+    	if(HX>HY) t=HX;
+    	else t=HY;
+    	fx[11] = (fx[8]-HXY1)/(t+0.00000001);
+    	fx[12] = sqrt(1-exp(-2*(HXY2 - fx[8])));
     }
 
-    for(i=0; i<2*data_max_gray-1; i++)
+    if(want_sum)
     {
-    	fx[6] = fx[6] + (i-fx[5])*(i-fx[5])*Pxplusy[i];
+    	for(i=0; i<m+n-1; i++)
+    	{
+    		fx[5] = fx[5] + i*Pxplusy[i];
+    		if(mask & HARALICK_F(8))
+    			fx[7] = fx[7] - Pxplusy[i]*log(Pxplusy[i]+0.00000001);
+    	}
+    	for(i=0; i<m+n-1; i++)
+    		fx[6] = fx[6] + (i-fx[5])*(i-fx[5])*Pxplusy[i];
     }
 
-    for(i=0; i<data_max_gray; i++)
+    if(want_diff)
     {
     	double temp=0;
-    	for(j=0; j<data_max_gray; j++)
-    	{
+    	for(j=0; j<n; j++)
     		temp = temp + j*Pxminusy[j];
+    	for(i=0; i<m; i++)
+    	{
+    		fx[9] = fx[9] + (i-temp)*(i-temp)*Pxminusy[i];
+    		if(mask & HARALICK_F(11))
+    			fx[10] = fx[10] - n*Pxminusy[i]*log(Pxminusy[i]+0.00000001);
     	}
-    	fx[9] = fx[9] + (i-temp)*(i-temp)*Pxminusy[i];
     }
 
-    double t;
-    if(HX>HY) t=HX;
-    else t=HY;
-    fx[11] = (fx[8]-HXY1)/(t+0.00000001);
-    fx[12] = sqrt(1-exp(-2*(HXY2 - fx[8])));
+    for(i=0; i<13; i++)
+    	if(!(mask & HARALICK_F(i+1)))
+    		fx[i] = 0;
+    if(mask & HARALICK_F(14))
+    	fx[13] = maximal_correlation_coefficient(P, m, n, Px, Py, s->work);
+    return fx;
+}
 
+/* Function to calculate Haralick parameters from the concurrence matrix
+ * Argurments: P: The cooccurance matrix
+ *             data_max_gray: max gray value
+ *             fx: The array to store the result*/
+double *calculate_haralick_parameters(double **P, int data_max_gray, double fx[13])
+{
+    HaralickScratch s;
+    init_haralick_scratch(&s, data_max_gray);
+    haralick_kernel(P, data_max_gray, data_max_gray, HARALICK_ALL, fx, &s);
+    free_haralick_scratch(&s);
     return fx;
+}
 
+/* Same as calculate_haralick_parameters, reusing the caller's scratch
+ * so that repeated calls do not allocate
+ */
+double *calculate_haralick_parameters_scratch(double **P, int data_max_gray, double fx[13], HaralickScratch *s)
+{
+    return haralick_kernel(P, data_max_gray, data_max_gray, HARALICK_ALL, fx, s);
 }
 
-/* To create co-occurance matrix
- * Arguements: data: The PGM image
- *             delta: The distance
- *             angle: The config in degrees
+/* To calculate only the Haralick parameters selected by mask
+ * Arguments: P: The cooccurance matrix, normalised in place
+ *            data_max_gray: max gray value
+ *            mask: HARALICK_F bits of the parameters wanted, the rest are 0
+ *            fx: The array to store the result (14 entries if f14 is wanted)
+ *            s: Scratch for the marginals
  */
-double *create_cooccurance_matrix(PGMData *data, int delta, int angle, double f[13])
+double *calculate_haralick_parameters_masked(double **P, int data_max_gray, unsigned int mask, double *fx, HaralickScratch *s)
 {
-//    printf("Creating Co-occurance matrix\n");
-	int delx, dely;
+    return haralick_kernel(P, data_max_gray, data_max_gray, mask, fx, s);
+}
+
+/* To convert a distance and an angle into the displacement of the neighbour
+ * 0, 45, 90 and 135 give the usual chessboard offsets; any other angle is
+ * rounded to the nearest pixel at that distance.
+ * Arguments: delta: The distance
+ *            angle: The config in degrees
+ *            delx, dely: To store the displacement into
+ */
+void angle_to_displacement(int delta, int angle, int *delx, int *dely)
+{
+    *delx = -(int)floor(delta*sin(angle*3.14159265/180) + 0.5);
+    *dely = (int)floor(delta*cos(angle*3.14159265/180) + 0.5);
     if(angle == 0)
     {
-    	delx = 0;
-    	dely = delta;
+    	*delx = 0;
+    	*dely = delta;
     }
     if(angle == 45)
     {
-    	delx = -delta;
-    	dely = delta;
+    	*delx = -delta;
+    	*dely = delta;
     }
     if(angle == 90)
     {
-    	delx=-delta;
-        dely = 0;
+    	*delx = -delta;
+        *dely = 0;
     }
     if(angle == 135)
     {
-    	delx = -delta;
-    	dely = -delta;
+    	*delx = -delta;
+    	*dely = -delta;
     }
+}
 
+/* One entry of a displacement table
+ * Holds the rows and columns whose neighbour lies inside the image, so the
+ * builders loop over them with no bounds checks per pixel.
+ */
+typedef struct _GLCMOffset
+{
+    int delx, dely;     // displacement of the neighbour
+    int xlo, xhi;       // rows xlo..xhi-1 have their neighbour row inside the image
+    int ylo, yhi;       // columns ylo..yhi-1 have their neighbour column inside the image
+}GLCMOffset;
 
-    double **P;
-    P = allocate_dynamic_matrix_double((data->max_gray), (data->max_gray));
+/* To find the valid ranges of one displacement in a width x height image */
+GLCMOffset make_glcm_offset(int delx, int dely, int width, int height)
+{
+    GLCMOffset o;
+    o.delx = delx;
+    o.dely = dely;
+    o.xlo = (delx < 0)? -delx:0;
+    o.xhi = (delx > 0)? width-delx:width;
+    o.ylo = (dely < 0)? -dely:0;
+    o.yhi = (dely > 0)? height-dely:height;
+    if(o.xhi < o.xlo) o.xhi = o.xlo;
+    if(o.yhi < o.ylo) o.yhi = o.ylo;
+    return o;
+}
 
-    int i,j,x,y;
+/* To precompute the displacement table of n arbitrary (delx,dely) vectors
+ * Arguments: n: No of offsets
+ *            delx, dely: The n displacements
+ *            width, height: Size of the image the table is used on
+ *            table: n entries to store the offsets into
+ */
+void make_displacement_table(int n, const int *delx, const int *dely, int width, int height, GLCMOffset *table)
+{
+    int k;
+    for(k=0; k<n; k++)
+    	table[k] = make_glcm_offset(delx[k], dely[k], width, height);
+}
+
+/* To fill the co-occurance matrix in a single scan over the image
+ * Every pixel (x,y) whose neighbour (x+delx,y+dely) lies inside the image
+ * adds one to P[I(x,y)][I(x+delx,y+dely)]. Gray values outside
+ * 0..max_gray-1 are not counted.
+ * Arguments: data: The PGM image
+ *            delx, dely: The displacement of the neighbour
+ *            P: max_gray x max_gray matrix to store the counts into
+ */
+void fill_cooccurance_matrix(PGMData *data, int delx, int dely, double **P)
+{
+    int i, j, x, y, a, b;
+    int G = data->max_gray;
+    GLCMOffset o = make_glcm_offset(delx, dely, data->width, data->height);
 
-    for(i=0;i<data->max_gray;i++)
-    	for(j=0;j<data->max_gray;j++)
+    for(i=0;i<G;i++)
+    	for(j=0;j<G;j++)
     		P[i][j]=0;
 
-    int temp1, temp2;
-    for(i=0;i<data->max_gray;i++)
+    for(x=o.xlo;x<o.xhi;x++)
     {
-    	for(j=0;j<data->max_gray;j++)
+    	int *row = data->pixels[x];
+    	int *next = data->pixels[x+delx] + dely;
+    	for(y=o.ylo;y<o.yhi;y++)
     	{
-    		for(x=0;x<data->width;x++)
-    		{
-    			for(y=0;y<data->height;y++)
-    			{
-                    temp1 = (x+delx >= 0)? x+delx:-1;
-                    temp2 = (y+dely >= 0)? y+dely:-1;
-                    if(temp1>=0 && temp2 >=0)
-    				if((data->pixels[x][y]==i && data->pixels[temp1][temp2]==j))// || (data->pixels[x][y]==j && data->pixels[temp1][temp2]==i))
-    				    P[i][j]=P[i][j]+1;
-    			}
-    		}
+    		a = row[y];
+    		b = next[y];
+    		if((unsigned)a < (unsigned)G && (unsigned)b < (unsigned)G)
+    			P[a][b]=P[a][b]+1;
     	}
     }
+}
+
+/* To create co-occurance matrix
+ * Arguements: data: The PGM image
+ *             delta: The distance
+ *             angle: The config in degrees
+ */
+double *create_cooccurance_matrix(PGMData *data, int delta, int angle, double f[13])
+{
+//    printf("Creating Co-occurance matrix\n");
+	int delx, dely;
+	angle_to_displacement(delta, angle, &delx, &dely);
+
+    double **P;
+    P = allocate_dynamic_matrix_double((data->max_gray), (data->max_gray));
+
+    fill_cooccurance_matrix(data, delx, dely, P);
 
 
 //    printf("Calculating Haralick parameters\n");
@@ -250,188 +487,1094 @@ double *create_cooccurance_matrix(PGMData *data, int delta, int angle, double f[
 }
 
 
-void write_haralick(int no, double *f, char *name, int n)
+/* To find c*log(c) of a count, from the scratch table when c is small */
+double count_log_count(HaralickScratch *s, double c)
 {
-    FILE *train_file;
-    int i;
-    train_file = fopen(name, "ab");
-    if (train_file == NULL) {
-        perror("Cannot open file to write\n");
-        exit(EXIT_FAILURE);
+    if(s->clogc == NULL)
+    {
+    	int k;
+    	s->clogc = (double *)malloc(sizeof(double) * CLOGC_TABLE_SIZE);
+    	if (s->clogc == NULL)
+    	{
+    		perror("Memory allocation failure");
+    		exit(1);
+    	}
+    	s->clogc[0] = 0;
+    	for(k=1; k<CLOGC_TABLE_SIZE; k++)
+    		s->clogc[k] = k*log(k);
     }
-    fprintf(train_file,"%d ",no);
-    for(i=0; i<n; i++)
+    if(c < CLOGC_TABLE_SIZE)
+    	return s->clogc[(int)c];
+    return c*log(c);
+}
+
+/* To add the pairs anchored in rows x0..x1-1 to an integer co-occurance matrix
+ * The neighbour rows may lie outside x0..x1-1; they are only read, so
+ * strips covering the image count every pair exactly once.
+ * Arguments: data: The PGM image
+ *            delx, dely: The displacement of the neighbour
+ *            x0, x1: The rows of the anchor pixels
+ *            C: max_gray x max_gray matrix to add the counts to
+ */
+void add_cooccurance_counts_rows(PGMData *data, int delx, int dely, int x0, int x1, unsigned int **C)
+{
+    int x, y, a, b;
+    int G = data->max_gray;
+    GLCMOffset o = make_glcm_offset(delx, dely, data->width, data->height);
+
+    if(x0 < o.xlo) x0 = o.xlo;
+    if(x1 > o.xhi) x1 = o.xhi;
+    for(x=x0;x<x1;x++)
     {
-    	fprintf(train_file,"%f ",f[i]);
+    	int *row = data->pixels[x];
+    	int *next = data->pixels[x+delx] + dely;
+    	for(y=o.ylo;y<o.yhi;y++)
+    	{
+    		a = row[y];
+    		b = next[y];
+    		if((unsigned)a < (unsigned)G && (unsigned)b < (unsigned)G)
+    			C[a][b]++;
+    	}
     }
-    fprintf(train_file,"\n");
 }
 
+/* To fill an integer co-occurance matrix in a single scan over the image
+ * Counts the same pairs as fill_cooccurance_matrix, in half the memory
+ * Arguments: data: The PGM image
+ *            delx, dely: The displacement of the neighbour
+ *            C: max_gray x max_gray matrix to store the counts into
+ */
+void fill_cooccurance_counts(PGMData *data, int delx, int dely, unsigned int **C)
+{
+    int i, j;
+    int G = data->max_gray;
 
-double *calculate_haralick_parameters_RIVLBP(double **P, double fx[13], int m, int n)
+    for(i=0;i<G;i++)
+    	for(j=0;j<G;j++)
+    		C[i][j]=0;
+    add_cooccurance_counts_rows(data, delx, dely, 0, data->width, C);
+}
+
+/* Work of one thread of the parallel co-occurance builder */
+typedef struct _GLCMStrip
 {
+    PGMData *data;
+    int delx, dely;
+    int x0, x1;             // rows of the anchor pixels of the strip
+    unsigned int **C;       // private partial matrix
+    unsigned int **src;     // partial matrix to merge into C
+}GLCMStrip;
+
+/* fill_cooccurance_counts restricted to the rows of the strip */
+void *fill_cooccurance_strip(void *arg)
+{
+    GLCMStrip *strip = (GLCMStrip *)arg;
+    int i, j, G = strip->data->max_gray;
+    for(i=0;i<G;i++)
+    	for(j=0;j<G;j++)
+    		strip->C[i][j]=0;
+    add_cooccurance_counts_rows(strip->data, strip->delx, strip->dely, strip->x0, strip->x1, strip->C);
+    return NULL;
+}
 
-//	printf("Calculating Haralick parameters\n");
-    /*Normalise the matrix*/
-	double N=0;
-    int i,j,k;
-    for(i=0;i<m;i++)
+void *merge_cooccurance_strips(void *arg)
+{
+    GLCMStrip *strip = (GLCMStrip *)arg;
+    int i, j, G = strip->data->max_gray;
+    for(i=0;i<G;i++)
     {
-    	for(j=0;j<n;j++)
+    	unsigned int *dst = strip->C[i], *src = strip->src[i];
+    	for(j=0;j<G;j++)
+    		dst[j] = dst[j] + src[j];
+    }
+    return NULL;
+}
+
+/* To fill an integer co-occurance matrix with several threads
+ * The image is split into n_threads strips of rows. Each thread counts the
+ * pairs anchored in its strip into a private matrix, reading the rows past
+ * the strip edge as a halo, and the partials are then summed pairwise in a
+ * tree (1+2, 3+4, ... then 1+3, ...) with the merges of a level in parallel.
+ * The result equals fill_cooccurance_counts. Link with -pthread.
+ * Arguments: data: The PGM image
+ *            delx, dely: The displacement of the neighbour
+ *            C: max_gray x max_gray matrix to store the counts into
+ *            n_threads: No of worker threads
+ */
+void fill_cooccurance_counts_parallel(PGMData *data, int delx, int dely, unsigned int **C, int n_threads)
+{
+    int t, step, G = data->max_gray;
+    if(n_threads > data->width) n_threads = data->width;
+    if(n_threads < 2)
+    {
+    	fill_cooccurance_counts(data, delx, dely, C);
+    	return;
+    }
+
+    GLCMStrip *strips = (GLCMStrip *)malloc(sizeof(GLCMStrip) * n_threads);
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * n_threads);
+    if (strips == NULL || threads == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+
+    for(t=0; t<n_threads; t++)
+    {
+    	strips[t].data = data;
+    	strips[t].delx = delx;
+    	strips[t].dely = dely;
+    	strips[t].x0 = (int)((long long)data->width * t / n_threads);
+    	strips[t].x1 = (int)((long long)data->width * (t+1) / n_threads);
+    	strips[t].C = (t == 0)? C:allocate_dynamic_matrix_uint(G, G);
+    	strips[t].src = NULL;
+    	if(pthread_create(&threads[t], NULL, fill_cooccurance_strip, &strips[t]))
     	{
-    		N = N + P[i][j];
+    		perror("Cannot create thread");
+    		exit(1);
     	}
     }
-    for(i=0;i<m;i++)
+    for(t=0; t<n_threads; t++)
+    	pthread_join(threads[t], NULL);
+
+    for(step=1; step<n_threads; step=step*2)
     {
-    	for(j=0;j<n;j++)
+    	for(t=0; t+step<n_threads; t=t+2*step)
     	{
-    		P[i][j] = P[i][j]/N;
-
+    		strips[t].src = strips[t+step].C;
+    		if(pthread_create(&threads[t], NULL, merge_cooccurance_strips, &strips[t]))
+    		{
+    			perror("Cannot create thread");
+    			exit(1);
+    		}
     	}
+    	for(t=0; t+step<n_threads; t=t+2*step)
+    		pthread_join(threads[t], NULL);
+    }
+
+    for(t=1; t<n_threads; t++)
+    	deallocate_dynamic_matrix_uint(strips[t].C, G);
+    free(strips);
+    free(threads);
+}
 
+/* To size the scratch for G gray levels and zero fx and the marginals
+ * that the pass over the counts adds into
+ */
+void clear_haralick_counts_sums(int G, double fx[13], HaralickScratch *s)
+{
+    int i, j;
+    reserve_haralick_scratch(s, G, G);
+
+    for(i=0; i<13; i++)
+        fx[i]=0;
+    for(j=0; j<G; j++)
+    	s->Py[j]=0;
+    for(i=0; i<2*G-1; i++)
+    {
+    	s->Pxplusy[i]=0;
+    	s->Pxminusy[i]=0;
     }
-//    printf("N = %f\tmax gray = %d\n",N,data_max_gray);
-    double Px[17000], Py[17000], ux, uy,u, sx, sy, Pxplusy[33000], Pxminusy[33000];
+}
 
-    for(i=0; i<m; i++)
+/* The part of calculate_haralick_parameters_counts after the pass over the
+ * counts: s holds the marginals as counts, N their total and sum_clogc the
+ * sum of c log c over the matrix
+ */
+double *finish_haralick_parameters_counts(int G, double N, double sum_clogc, double fx[13], HaralickScratch *s)
+{
+    int i;
+    double ux=0, uy=0, u, sx=0, sy=0;
+    double HX, HY, HXY;
+    double *Px = s->Px, *Py = s->Py, *Pxplusy = s->Pxplusy, *Pxminusy = s->Pxminusy;
+
+    if(N == 0)
+    	return fx;
+
+    fx[0] = fx[0]/(N*N);
+    fx[1] = fx[1]/N;
+    fx[4] = fx[4]/N;
+    fx[8] = log(N) - sum_clogc/N;
+
+    HX = log(N);
+    HY = log(N);
+    for(i=0; i<G; i++)
     {
-    	Px[i]=0;
-       	Py[i]=0;
-       	for(j=0; j<n; j++)
-       	{
-       		Px[i] = Px[i]+P[i][j];
-       		Py[i] = Py[i]+P[j][i];
-       	}
+    	HX = HX - count_log_count(s, Px[i])/N;
+    	HY = HY - count_log_count(s, Py[i])/N;
+    	Px[i] = Px[i]/N;
+    	Py[i] = Py[i]/N;
+    	ux = ux + i*Px[i];
+    	uy = uy + i*Py[i];
     }
+    HXY = HX + HY;
+    u = 0.5*ux + 0.5*uy;
 
-    ux=0; uy=0, u=0;
-    for(i=0;i<m;i++)
+    for(i=0; i<G; i++)
     {
-      	ux = ux + i*Px[i];
+    	sx = sx + Px[i]*(i-ux)*(i-ux);
+    	sy = sy + Py[i]*(i-uy)*(i-uy);
+    	fx[2] = fx[2] + (i-ux)*(i-uy)*Px[i];
+    	fx[3] = fx[3] + (i-u)*(i-u)*Px[i];
     }
-    for(i=0; i<n; i++)
+    sx = sqrt(sx);
+    sy = sqrt(sy);
+    fx[2] = fx[2]/(sx*sy +0.00000001);
+
+    fx[7] = log(N);
+    for(i=0; i<2*G-1; i++)
     {
-       	uy = uy + i*Py[i];
+    	fx[7] = fx[7] - count_log_count(s, Pxplusy[i])/N;
+    	Pxplusy[i] = Pxplusy[i]/N;
+    	fx[5] = fx[5] + i*Pxplusy[i];
     }
+    for(i=0; i<2*G-1; i++)
+    	fx[6] = fx[6] + (i-fx[5])*(i-fx[5])*Pxplusy[i];
 
-    for(k=0; k<m+n-1; k++)
+    double temp=0, HD=log(N);
+    for(i=0; i<G; i++)
     {
-       	Pxplusy[k]=0;
-       	Pxminusy[k]=0;
+    	HD = HD - count_log_count(s, Pxminusy[i])/N;
+    	Pxminusy[i] = Pxminusy[i]/N;
+    	temp = temp + i*Pxminusy[i];
     }
+    for(i=0; i<G; i++)
+    	fx[9] = fx[9] + (i-temp)*(i-temp)*Pxminusy[i];
+    /* f11 keeps the max_gray scaling of calculate_haralick_parameters */
+    fx[10] = G*HD;
 
+    double t;
+    if(HX>HY) t=HX;
+    else t=HY;
+    fx[11] = (fx[8]-HXY)/(t+0.00000001);
+    fx[12] = sqrt(1-exp(-2*(HXY - fx[8])));
 
+    return fx;
+}
 
-    for(i=0; i<m; i++)
-    {
-       	for(j=0; j<n; j++)
-       	{
-       		Pxplusy[i+j] = Pxplusy[i+j]+P[i][j];
-       		if(i>=j)
-       			Pxminusy[i-j] = Pxminusy[i-j]+P[i][j];
-       		else
-       			Pxminusy[j-i] = Pxminusy[j-i]+P[i][j];
+/* Function to calculate Haralick parameters from an integer co-occurance matrix
+ * The entropies use -sum p log p = log N - (1/N) sum c log c over the raw
+ * counts, with c log c looked up in the scratch table, so the O(G^2) pass
+ * has no log calls. HXY1 and HXY2 are taken as HX+HY, which the sums over
+ * P and Px*Py reduce to. Unlike calculate_haralick_parameters there is no
+ * 1e-8 guard inside the logs, so the entropy based parameters f8, f9, f11,
+ * f12 and f13 differ from it by ~1e-7 to 1e-6; the others match.
+ * Arguments: C: The cooccurance counts, left unchanged
+ *            data_max_gray: max gray value
+ *            fx: The array to store the result
+ *            s: Scratch for the marginals
+ */
+double *calculate_haralick_parameters_counts(unsigned int **C, int data_max_gray, double fx[13], HaralickScratch *s)
+{
+    int G = data_max_gray;
+    int i, j;
+    double N=0, sum_clogc=0;
 
-      	}
+    clear_haralick_counts_sums(G, fx, s);
+    double *Px = s->Px, *Py = s->Py, *Pxplusy = s->Pxplusy, *Pxminusy = s->Pxminusy;
+
+    /* One pass over the counts; the marginals are kept as counts too */
+    for(i=0; i<G; i++)
+    {
+    	unsigned int *row = C[i];
+    	double px = 0;
+    	for(j=0; j<G; j++)
+    	{
+    		double c = row[j];
+    		double k = i-j;
+    		if(row[j] == 0) continue;
+    		px = px + c;
+    		Py[j] = Py[j] + c;
+    		Pxplusy[i+j] = Pxplusy[i+j] + c;
+    		Pxminusy[(i>=j)? i-j:j-i] = Pxminusy[(i>=j)? i-j:j-i] + c;
+    		fx[0] = fx[0] + c*c;
+    		if(i>=j)
+    			fx[1] = fx[1] + c*k*k;
+    		fx[4] = fx[4] + c/(1+k*k);
+    		sum_clogc = sum_clogc + count_log_count(s, c);
+    	}
+    	Px[i] = px;
+    	N = N + px;
     }
+    return finish_haralick_parameters_counts(G, N, sum_clogc, fx, s);
+}
 
-    u = 0.5* ux+ 0.5*uy;
+/* As calculate_haralick_parameters_counts for 64 bit counts, for images so
+ * large that a bin can pass 2^32 (the banded whole slide path)
+ */
+double *calculate_haralick_parameters_counts64(unsigned long long **C, int data_max_gray, double fx[13], HaralickScratch *s)
+{
+    int G = data_max_gray;
+    int i, j;
+    double N=0, sum_clogc=0;
 
-    sx = 0; sy = 0;
-    for(i=0; i<m; i++)
+    clear_haralick_counts_sums(G, fx, s);
+    double *Px = s->Px, *Py = s->Py, *Pxplusy = s->Pxplusy, *Pxminusy = s->Pxminusy;
+
+    /* One pass over the counts; the marginals are kept as counts too */
+    for(i=0; i<G; i++)
     {
-      	sx = sx+Px[i]*(i-ux)*(i-ux);
+    	unsigned long long *row = C[i];
+    	double px = 0;
+    	for(j=0; j<G; j++)
+    	{
+    		double c = row[j];
+    		double k = i-j;
+    		if(row[j] == 0) continue;
+    		px = px + c;
+    		Py[j] = Py[j] + c;
+    		Pxplusy[i+j] = Pxplusy[i+j] + c;
+    		Pxminusy[(i>=j)? i-j:j-i] = Pxminusy[(i>=j)? i-j:j-i] + c;
+    		fx[0] = fx[0] + c*c;
+    		if(i>=j)
+    			fx[1] = fx[1] + c*k*k;
+    		fx[4] = fx[4] + c/(1+k*k);
+    		sum_clogc = sum_clogc + count_log_count(s, c);
+    	}
+    	Px[i] = px;
+    	N = N + px;
     }
-    for(i=0; i<n; i++)
+    return finish_haralick_parameters_counts(G, N, sum_clogc, fx, s);
+}
+
+/* To create an integer co-occurance matrix and find its Haralick parameters
+ * Arguements: data: The PGM image
+ *             delta: The distance
+ *             angle: The config in degrees
+ */
+double *create_cooccurance_counts(PGMData *data, int delta, int angle, double f[13])
+{
+    int delx, dely;
+    HaralickScratch s;
+    unsigned int **C;
+    angle_to_displacement(delta, angle, &delx, &dely);
+
+    C = allocate_dynamic_matrix_uint(data->max_gray, data->max_gray);
+    init_haralick_scratch(&s, data->max_gray);
+    fill_cooccurance_counts(data, delx, dely, C);
+    calculate_haralick_parameters_counts(C, data->max_gray, f, &s);
+    free_haralick_scratch(&s);
+    deallocate_dynamic_matrix_uint(C, data->max_gray);
+    return f;
+}
+
+/* To create co-occurance matrix with several threads
+ * The counts are built by fill_cooccurance_counts_parallel and the
+ * parameters by calculate_haralick_parameters, so the result is the same
+ * as create_cooccurance_matrix.
+ * Arguements: data: The PGM image
+ *             delta: The distance
+ *             angle: The config in degrees
+ *             n_threads: No of worker threads
+ */
+double *create_cooccurance_matrix_parallel(PGMData *data, int delta, int angle, int n_threads, double f[13])
+{
+    int delx, dely, i, j, G = data->max_gray;
+    unsigned int **C;
+    double **P;
+    angle_to_displacement(delta, angle, &delx, &dely);
+
+    C = allocate_dynamic_matrix_uint(G, G);
+    fill_cooccurance_counts_parallel(data, delx, dely, C, n_threads);
+    P = allocate_dynamic_matrix_double(G, G);
+    for(i=0;i<G;i++)
+    	for(j=0;j<G;j++)
+    		P[i][j] = C[i][j];
+    deallocate_dynamic_matrix_uint(C, G);
+
+    calculate_haralick_parameters(P, G, f);
+    deallocate_dynamic_matrix_double(P, G);
+    return f;
+}
+
+/* Running sums of the co-occurance counts inside a sliding window
+ * Enough to give f1 (ASM), f2 (contrast), f5 (IDM) and f9 (entropy)
+ * after every move without looking at the whole matrix.
+ */
+typedef struct _TextureWindow
+{
+    int max_gray;
+    unsigned int **C;   // counts of the pairs inside the window
+    double N;           // sum of C
+    double sq;          // sum of C^2
+    double contrast;    // sum of (i-j)^2 C over i>=j
+    double idm;         // sum of C/(1+(i-j)^2)
+    double clogc;       // sum of C log C
+    HaralickScratch s;  // holds the c*log(c) table
+}TextureWindow;
+
+/* To add delta (+1 or -1) to one bin and update the sums */
+void update_texture_window_bin(TextureWindow *w, int a, int b, int delta)
+{
+    double c = w->C[a][b];
+    double k = a-b;
+    double cnew = c + delta;
+
+    w->C[a][b] = (unsigned int)cnew;
+    w->N = w->N + delta;
+    w->sq = w->sq + cnew*cnew - c*c;
+    if(a>=b)
+    	w->contrast = w->contrast + delta*k*k;
+    w->idm = w->idm + delta/(1+k*k);
+    w->clogc = w->clogc + count_log_count(&w->s, cnew) - count_log_count(&w->s, c);
+}
+
+/* To add or remove (delta = +1/-1) the pairs of the window that have a pixel in column col
+ * The window is rows x0..x1 and columns c0..c1 (inclusive); both pixels
+ * of a pair must be inside it.
+ */
+void update_texture_window_column(PGMData *data, TextureWindow *w, int delx, int dely, int x0, int x1, int c0, int c1, int col, int delta)
+{
+    int x, y, a, b, pass;
+    int G = w->max_gray;
+    int xlo = (x0-delx > x0)? x0-delx:x0, xhi = (x1-delx < x1)? x1-delx:x1;
+
+    /* pass 0: anchor in col, pass 1: neighbour in col */
+    for(pass=0; pass<2; pass++)
     {
-       	sy = sy+Py[i]*(i-uy)*(i-uy);
+    	if(pass == 1 && dely == 0)
+    		break;
+    	y = (pass == 0)? col:col-dely;
+    	if(y < c0 || y > c1 || y+dely < c0 || y+dely > c1)
+    		continue;
+    	for(x=xlo; x<=xhi; x++)
+    	{
+    		a = data->pixels[x][y];
+    		b = data->pixels[x+delx][y+dely];
+    		if((unsigned)a < (unsigned)G && (unsigned)b < (unsigned)G)
+    			update_texture_window_bin(w, a, b, delta);
+    	}
     }
+}
 
+/* To read parameter no. feature (index into fx) off the running sums */
+double texture_window_feature(TextureWindow *w, int feature)
+{
+    if(w->N == 0)
+    	return 0;
+    if(feature == 0)
+    	return w->sq/(w->N*w->N);
+    if(feature == 1)
+    	return w->contrast/w->N;
+    if(feature == 4)
+    	return w->idm/w->N;
+    return log(w->N) - w->clogc/w->N;
+}
 
-    sx = sqrt(sx);
-    sy = sqrt(sy);
-
+/* To compute dense Haralick texture maps over a sliding window
+ * For every pixel whose window fits in the image, the parameters of the
+ * co-occurance matrix of the window x window neighbourhood around it are
+ * stored; the border is left 0. Moving the window one column only removes
+ * the pairs touching the leaving column and adds those touching the
+ * entering one, updating running sums of the touched bins, so a pixel costs
+ * O(window) instead of O(window^2 + max_gray^2).
+ * Use make_PGM to turn a map into a PGMData.
+ * Arguments: data: The PGM image
+ *            window: Odd side of the window
+ *            delta: The distance
+ *            angle: The config in degrees
+ *            n_features: No of maps wanted
+ *            features: Index into fx of each map: 0 (f1, ASM), 1 (f2, contrast),
+ *                      4 (f5, IDM) or 8 (f9, entropy)
+ *            maps: n_features pointers, each set to a width x height matrix
+ */
+void haralick_texture_maps(PGMData *data, int window, int delta, int angle, int n_features, const int *features, double ***maps)
+{
+    int delx, dely, i, j, k, x, y;
+    int r = window/2, G = data->max_gray;
+    TextureWindow w;
 
-    double HXY1, HXY2, HX=0, HY=0;
-    for(i=0; i<m; i++)
+    if(window < 1 || window%2 == 0)
     {
-        HX = HX - Px[i]*log(Px[i]+0.00000001);
+    	fprintf(stderr, "Texture map window must be odd and at least 1, not %d!\n", window);
+    	exit(1);
     }
-    for(i=0; i<n; i++)
+    for(k=0; k<n_features; k++)
     {
-  	    HY = HY - Py[i]*log(Py[i]+0.00000001);
+    	if(features[k] != 0 && features[k] != 1 && features[k] != 4 && features[k] != 8)
+    	{
+    		fprintf(stderr, "Texture map of parameter f%d is not supported!\n", features[k]+1);
+    		exit(1);
+    	}
+    	maps[k] = allocate_dynamic_matrix_double(data->width, data->height);
+    	for(i=0; i<data->width; i++)
+    		for(j=0; j<data->height; j++)
+    			maps[k][i][j] = 0;
     }
 
+    if(window > data->width || window > data->height)
+    	return;
 
-    HXY1 = 0; HXY2 = 0;
-    for(i=0; i<m; i++)
+    angle_to_displacement(delta, angle, &delx, &dely);
+    w.max_gray = G;
+    w.C = allocate_dynamic_matrix_uint(G, G);
+    for(i=0; i<G; i++)
+    	for(j=0; j<G; j++)
+    		w.C[i][j] = 0;
+    w.N = w.sq = w.contrast = w.idm = w.clogc = 0;
+    init_haralick_scratch(&w.s, 0);
+
+    for(x=r; x<data->width-r; x++)
     {
-     	for(j=0; j<n; j++)
-     	{
-   		    HXY1 = HXY1 - P[i][j]*log(Px[i]*Py[j] +0.00000001);
-            HXY2 = HXY2 - Px[i]*Py[j]*log(Px[i]*Py[j] +0.00000001);
-       	}
-   	}
+    	int x0 = x-r, x1 = x+r;
+
+    	for(y=0; y<window && y<data->height; y++)
+    		update_texture_window_column(data, &w, delx, dely, x0, x1, 0, y, y, 1);
+
+    	for(y=r; y<data->height-r; y++)
+    	{
+    		if(y > r)
+    		{
+    			update_texture_window_column(data, &w, delx, dely, x0, x1, y-r-1, y+r-1, y-r-1, -1);
+    			update_texture_window_column(data, &w, delx, dely, x0, x1, y-r, y+r, y+r, 1);
+    		}
+    		for(k=0; k<n_features; k++)
+    			maps[k][x][y] = texture_window_feature(&w, features[k]);
+    	}
 
+    	/* Empty the window before the next row; C is exact, but the sums
+    	 * are reset so their rounding error does not carry over */
+    	y = data->height-r-1;
+    	for(j=y-r; j<=y+r; j++)
+    		update_texture_window_column(data, &w, delx, dely, x0, x1, j, y+r, j, -1);
+    	w.N = w.sq = w.contrast = w.idm = w.clogc = 0;
+    }
 
+    free_haralick_scratch(&w.s);
+    deallocate_dynamic_matrix_uint(w.C, G);
+}
+
+/* Position of (i,j), i<=j, in a packed upper triangular max_gray x max_gray matrix */
+#define TRI_INDEX(i,j,G) ((long long)(i)*(G) - (long long)(i)*((i)-1)/2 + ((j)-(i)))
+
+/* To fill a symmetric co-occurance matrix in packed upper triangular form
+ * The matrix is C + transpose(C) of the one fill_cooccurance_matrix gives:
+ * a pair (a,b) adds 1 to both P[a][b] and P[b][a], so a diagonal pair adds 2.
+ * Only P[i][j] with i<=j is stored, in G*(G+1)/2 entries (see TRI_INDEX).
+ * Arguments: data: The PGM image
+ *            delx, dely: The displacement of the neighbour
+ *            T: G*(G+1)/2 entries to store the counts into
+ */
+void fill_symmetric_cooccurance_matrix(PGMData *data, int delx, int dely, double *T)
+{
+    int x, y, a, b;
+    int G = data->max_gray;
+    long long k;
+    GLCMOffset o = make_glcm_offset(delx, dely, data->width, data->height);
+
+    for(k=0; k<(long long)G*(G+1)/2; k++)
+    	T[k] = 0;
+
+    for(x=o.xlo;x<o.xhi;x++)
+    {
+    	int *row = data->pixels[x];
+    	int *next = data->pixels[x+delx] + dely;
+    	for(y=o.ylo;y<o.yhi;y++)
+    	{
+    		a = row[y];
+    		b = next[y];
+    		if((unsigned)a >= (unsigned)G || (unsigned)b >= (unsigned)G)
+    			continue;
+    		if(a < b)
+    			T[TRI_INDEX(a,b,G)] = T[TRI_INDEX(a,b,G)] + 1;
+    		else if(a > b)
+    			T[TRI_INDEX(b,a,G)] = T[TRI_INDEX(b,a,G)] + 1;
+    		else
+    			T[TRI_INDEX(a,a,G)] = T[TRI_INDEX(a,a,G)] + 2;
+    	}
+    }
+}
+
+/* Function to calculate Haralick parameters from a packed symmetric co-occurance matrix
+ * Gives the parameters haralick_kernel finds on the full matrix while reading
+ * only the upper triangle: off diagonal entries count twice in the sums, once
+ * in the i>=j contrast sum, and Px = Py.
+ * Arguments: T: The packed matrix, normalised in place
+ *            data_max_gray: max gray value
+ *            fx: The array to store the result
+ *            s: Scratch for the marginals
+ */
+double *calculate_haralick_parameters_symmetric(double *T, int data_max_gray, double fx[13], HaralickScratch *s)
+{
+    int G = data_max_gray;
+    int i, j;
+    long long k;
+    double N=0, ux=0, u, sx=0;
 
-//    printf("ux = %g\t\tuy = %g\t\tsx = %g\t\tsy=%g\t\tu = %f\n",ux,uy,sx,sy,u);
-//    printf("HXY1 = %g\t\tHXY2 = %g\t\tHX = %g\t\tHY = %g\n",HXY1,HXY2,HX,HY);
+    reserve_haralick_scratch(s, G, G);
+    double *Px = s->Px, *Pxplusy = s->Pxplusy, *Pxminusy = s->Pxminusy;
 
+    k = 0;
+    for(i=0; i<G; i++)
+    {
+    	N = N + T[k];
+    	for(j=i+1, k++; j<G; j++, k++)
+    		N = N + 2*T[k];
+    }
 
-    for(i=0; i<14; i++)
+    for(i=0; i<13; i++)
         fx[i]=0;
-    for(i=0; i<m; i++)
+    for(i=0; i<G; i++)
+    	Px[i]=0;
+    for(i=0; i<2*G-1; i++)
+    {
+    	Pxplusy[i]=0;
+    	Pxminusy[i]=0;
+    }
+
+    k = 0;
+    for(i=0; i<G; i++)
     {
-    	for(j=0;j<n; j++)
+    	for(j=i; j<G; j++, k++)
     	{
-    		fx[0] = fx[0] + P[i][j]*P[i][j];
-    		fx[2] = fx[2] + (i-ux)*(i-uy)*P[i][j]/(sx*sy +0.00000001);
-    		fx[3] = fx[3] + (i-u)*(i-u)*P[i][j];
-    		fx[4] = fx[4] + P[i][j]/(1+(i-j)*(i-j));
-    		fx[8] = fx[8] - P[i][j]*log(P[i][j]+0.00000001);
-    		fx[10] = fx[10] - Pxminusy[i]*log(Pxminusy[i]+0.00000001);
+    		double p = T[k]/N;
+    		double w = (i==j)? 1:2;
+    		double d = j-i;
+    		T[k] = p;
+    		Px[i] = Px[i] + p;
+    		if(i!=j)
+    			Px[j] = Px[j] + p;
+    		Pxplusy[i+j] = Pxplusy[i+j] + w*p;
+    		Pxminusy[j-i] = Pxminusy[j-i] + w*p;
+    		fx[0] = fx[0] + w*p*p;
+    		fx[1] = fx[1] + p*d*d;
+    		fx[4] = fx[4] + w*p/(1+d*d);
+    		fx[8] = fx[8] - w*p*log(p+0.00000001);
     	}
     }
 
+    for(i=0; i<G; i++)
+    	ux = ux + i*Px[i];
+    u = ux;
+    for(i=0; i<G; i++)
+    {
+    	sx = sx + Px[i]*(i-ux)*(i-ux);
+    	fx[3] = fx[3] + (i-u)*(i-u)*Px[i];
+    }
+    /* sx = sy, so f3 is var/(sqrt(var)^2) */
+    fx[2] = sx/(sx +0.00000001);
 
-    int x;
-    if(m>n) x=m;
-    else x=n;
-    for(k=0; k<x; k++)
+    double HXY1=0, HXY2=0, HX=0;
+    for(i=0; i<G; i++)
+    	HX = HX - Px[i]*log(Px[i]+0.00000001);
+
+    k = 0;
+    for(i=0; i<G; i++)
     {
-    	for(i=0; i<m; i++)
+    	for(j=i; j<G; j++, k++)
     	{
-    		for(j=0; j<n; j++)
-    		{
-    			if(i-j == k)
-    				fx[1]=fx[1]+ P[i][j]*k*k;
-    		}
+    		double w = (i==j)? 1:2;
+    		double pxy = Px[i]*Px[j];
+    		double l = log(pxy +0.00000001);
+    		HXY1 = HXY1 - w*T[k]*l;
+    		HXY2 = HXY2 - w*pxy*l;
     	}
     }
 
-    for(i=0; i<m+n-1; i++)
+    for(i=0; i<2*G-1; i++)
     {
     	fx[5] = fx[5] + i*Pxplusy[i];
     	fx[7] = fx[7] - Pxplusy[i]*log(Pxplusy[i]+0.00000001);
     }
+    for(i=0; i<2*G-1; i++)
+    	fx[6] = fx[6] + (i-fx[5])*(i-fx[5])*Pxplusy[i];
 
-    for(i=0; i<m+n-1; i++)
+    double temp=0;
+    for(i=0; i<G; i++)
+    	temp = temp + i*Pxminusy[i];
+    for(i=0; i<G; i++)
     {
-    	fx[6] = fx[6] + (i-fx[5])*(i-fx[5])*Pxplusy[i];
+    	fx[9] = fx[9] + (i-temp)*(i-temp)*Pxminusy[i];
+    	fx[10] = fx[10] - G*Pxminusy[i]*log(Pxminusy[i]+0.00000001);
     }
 
-    for(i=0; i<m; i++)
+    fx[11] = (fx[8]-HXY1)/(HX+0.00000001);
+    fx[12] = sqrt(1-exp(-2*(HXY2 - fx[8])));
+
+    return fx;
+}
+
+/* To create a symmetric co-occurance matrix and find its Haralick parameters
+ * Arguements: data: The PGM image
+ *             delta: The distance
+ *             angle: The config in degrees
+ */
+double *create_symmetric_cooccurance_matrix(PGMData *data, int delta, int angle, double f[13])
+{
+    int delx, dely, G = data->max_gray;
+    HaralickScratch s;
+    double *T;
+    /* size_t, as G*(G+1)/2 overflows an int once G > 46340 */
+    size_t size = (size_t)G*(G+1)/2;
+    angle_to_displacement(delta, angle, &delx, &dely);
+
+    T = (double *)malloc(sizeof(double) * (size ? size : 1));
+    if (T == NULL)
     {
-    	double temp=0;
-    	for(j=0; j<n; j++)
+        perror("Memory allocation failure");
+        exit(1);
+    }
+    init_haralick_scratch(&s, G);
+    fill_symmetric_cooccurance_matrix(data, delx, dely, T);
+    calculate_haralick_parameters_symmetric(T, G, f, &s);
+    free_haralick_scratch(&s);
+    free(T);
+    return f;
+}
+
+/* To create co-occurance matrix of the image requantised to the given levels
+ * The image itself is not modified.
+ * Arguements: data: The PGM image
+ *             delta: The distance
+ *             angle: The config in degrees
+ *             levels, mode, edges: As in make_quantisation_table
+ */
+double *create_quantised_cooccurance_matrix(PGMData *data, int delta, int angle, int levels, int mode, const int *edges, double f[13])
+{
+    PGMData quantised = copy_quantisePGM(data, levels, mode, edges);
+    create_cooccurance_matrix(&quantised, delta, angle, f);
+    deallocate_dynamic_matrix(quantised.pixels, quantised.width);
+    return f;
+}
+
+/* To create the co-occurance matrices of any set of displacements in one sweep
+ * The valid rows and columns of every offset come from a displacement table,
+ * and the image is traversed once row by row; every row updates the matrices
+ * of all the offsets while it and its neighbour rows are still in cache.
+ * Arguements: data: The PGM image
+ *             n: The number of offsets
+ *             delx, dely: The n displacements, of any length and direction
+ *             f: n x 13 matrix to store the parameters of each offset into
+ *             mean: If not NULL, stores the 13 parameters averaged over the offsets
+ *             range: If not NULL, stores max-min of the 13 parameters over the offsets
+ */
+double **create_cooccurance_matrices_offsets(PGMData *data, int n, const int *delx, const int *dely, double **f, double *mean, double *range)
+{
+    int G = data->max_gray;
+    int i, j, k, x, y, a, b;
+    GLCMOffset *table;
+    double ***P;
+    if (n < 1)
+    {
+    	fprintf(stderr, "At least one offset is needed, not %d!\n", n);
+    	exit(1);
+    }
+    table = (GLCMOffset *)malloc(sizeof(GLCMOffset) * n);
+    P = (double ***)malloc(sizeof(double **) * n);
+    if (table == NULL || P == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+
+    make_displacement_table(n, delx, dely, data->width, data->height, table);
+    for(k=0; k<n; k++)
+    {
+    	P[k] = allocate_dynamic_matrix_double(G, G);
+    	for(i=0;i<G;i++)
+    		for(j=0;j<G;j++)
+    			P[k][i][j]=0;
+    }
+
+    for(x=0; x<data->width; x++)
+    {
+    	int *row = data->pixels[x];
+    	for(k=0; k<n; k++)
     	{
-    		temp = temp + j*Pxminusy[j];
+    		GLCMOffset *o = &table[k];
+    		if(x < o->xlo || x >= o->xhi)
+    			continue;
+    		int *next = data->pixels[x+o->delx] + o->dely;
+    		double **Pk = P[k];
+    		for(y=o->ylo; y<o->yhi; y++)
+    		{
+    			a = row[y];
+    			b = next[y];
+    			if((unsigned)a < (unsigned)G && (unsigned)b < (unsigned)G)
+    				Pk[a][b]=Pk[a][b]+1;
+    		}
     	}
-    	fx[9] = fx[9] + (i-temp)*(i-temp)*Pxminusy[i];
     }
 
+    HaralickScratch s;
+    init_haralick_scratch(&s, G);
+    for(k=0; k<n; k++)
+    {
+    	calculate_haralick_parameters_scratch(P[k], G, f[k], &s);
+    	deallocate_dynamic_matrix_double(P[k], G);
+    }
+    free_haralick_scratch(&s);
+
+    for(i=0; i<13; i++)
+    {
+    	double sum = f[0][i], max = f[0][i], min = f[0][i];
+    	for(k=1; k<n; k++)
+    	{
+    		sum = sum + f[k][i];
+    		if(f[k][i]>max) max = f[k][i];
+    		if(f[k][i]<min) min = f[k][i];
+    	}
+    	if(mean != NULL) mean[i] = sum/n;
+    	if(range != NULL) range[i] = max-min;
+    }
+
+    free(P);
+    free(table);
+    return f;
+}
+
+/* To create the co-occurance matrices of several (distance, angle) offsets in one sweep
+ * Arguements: data: The PGM image
+ *             n: The number of offsets
+ *             delta: The n distances
+ *             angle: The n configs in degrees
+ *             f, mean, range: As in create_cooccurance_matrices_offsets
+ */
+double **create_cooccurance_matrices(PGMData *data, int n, int *delta, int *angle, double **f, double *mean, double *range)
+{
+    int k;
+    int *delx = (int *)malloc(sizeof(int) * n);
+    int *dely = (int *)malloc(sizeof(int) * n);
+    if (delx == NULL || dely == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+
+    for(k=0; k<n; k++)
+    	angle_to_displacement(delta[k], angle[k], &delx[k], &dely[k]);
+    create_cooccurance_matrices_offsets(data, n, delx, dely, f, mean, range);
+
+    free(delx);
+    free(dely);
+    return f;
+}
+
+
+/* Structure of a sparse co-occurance matrix
+ * Only the nonzero (i,j) pairs are kept, in an open addressing hash table,
+ * so the memory grows with the number of distinct pairs instead of max_gray^2
+ */
+typedef struct _SparseGLCM
+{
+    int max_gray;       // no of gray levels
+    int size;           // no of slots in the table (power of 2)
+    int count;          // no of nonzero pairs
+    long long *keys;    // i*max_gray+j of each slot, -1 if empty
+    double *values;     // count of each slot
+}SparseGLCM;
+
+/* To allocate an empty sparse co-occurance matrix
+ * Arguments: S: The matrix
+ *            max_gray: max gray value
+ *            capacity: Expected no of nonzero pairs
+ */
+void init_sparse_glcm(SparseGLCM *S, int max_gray, int capacity)
+{
+    int i;
+    S->max_gray = max_gray;
+    S->count = 0;
+    S->size = 64;
+    while(S->size < 2*capacity)
+    	S->size = S->size*2;
+
+    S->keys = (long long *)malloc(sizeof(long long) * S->size);
+    S->values = (double *)malloc(sizeof(double) * S->size);
+    if (S->keys == NULL || S->values == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+    for(i=0; i<S->size; i++)
+    {
+    	S->keys[i] = -1;
+    	S->values[i] = 0;
+    }
+}
+
+void free_sparse_glcm(SparseGLCM *S)
+{
+    free(S->keys);
+    free(S->values);
+    S->keys = NULL;
+    S->values = NULL;
+    S->size = 0;
+    S->count = 0;
+}
+
+/* To find the slot of a key, returns an empty slot if it is not present */
+int find_sparse_glcm_slot(SparseGLCM *S, long long key)
+{
+    unsigned long long h = (unsigned long long)key * 0x9E3779B97F4A7C15ULL;
+    int slot = (int)(h >> 32) & (S->size-1);
+    while(S->keys[slot] != -1 && S->keys[slot] != key)
+    	slot = (slot+1) & (S->size-1);
+    return slot;
+}
+
+/* To add v to the pair (i,j), doubling the table when it is half full */
+void add_sparse_glcm(SparseGLCM *S, int i, int j, double v)
+{
+    long long key = (long long)i*S->max_gray + j;
+    int slot = find_sparse_glcm_slot(S, key);
+
+    if(S->keys[slot] == -1)
+    {
+    	if(2*(S->count+1) > S->size)
+    	{
+    		SparseGLCM grown;
+    		int k;
+    		init_sparse_glcm(&grown, S->max_gray, S->size);
+    		for(k=0; k<S->size; k++)
+    		{
+    			if(S->keys[k] != -1)
+    			{
+    				int s = find_sparse_glcm_slot(&grown, S->keys[k]);
+    				grown.keys[s] = S->keys[k];
+    				grown.values[s] = S->values[k];
+    			}
+    		}
+    		grown.count = S->count;
+    		free_sparse_glcm(S);
+    		*S = grown;
+    		slot = find_sparse_glcm_slot(S, key);
+    	}
+    	S->keys[slot] = key;
+    	S->count++;
+    }
+    S->values[slot] = S->values[slot] + v;
+}
+
+/* To fill a sparse co-occurance matrix in a single scan over the image
+ * Counts the same pairs as fill_cooccurance_matrix
+ * Arguments: data: The PGM image
+ *            delx, dely: The displacement of the neighbour
+ *            S: Empty sparse matrix initialised with data->max_gray
+ */
+void fill_sparse_cooccurance_matrix(PGMData *data, int delx, int dely, SparseGLCM *S)
+{
+    int x, y, a, b;
+    int G = data->max_gray;
+    GLCMOffset o = make_glcm_offset(delx, dely, data->width, data->height);
+
+    for(x=o.xlo;x<o.xhi;x++)
+    {
+    	int *row = data->pixels[x];
+    	int *next = data->pixels[x+delx] + dely;
+    	for(y=o.ylo;y<o.yhi;y++)
+    	{
+    		a = row[y];
+    		b = next[y];
+    		if((unsigned)a < (unsigned)G && (unsigned)b < (unsigned)G)
+    			add_sparse_glcm(S, a, b, 1);
+    	}
+    }
+}
+
+/* Function to calculate Haralick parameters from a sparse co-occurance matrix
+ * The sums over P only visit the nonzero pairs; the marginals are O(max_gray).
+ * HXY2 is taken as HX+HY (without the 1e-8 guard), which is what the double
+ * sum over Px[i]*Py[j] reduces to, so no max_gray^2 loop is left.
+ * Arguments: S: The sparse cooccurance matrix, normalised in place
+ *            fx: The array to store the result
+ *            s: Scratch for the marginals, grown to max_gray if needed
+ */
+double *calculate_haralick_parameters_sparse(SparseGLCM *S, double fx[13], HaralickScratch *s)
+{
+    int G = S->max_gray;
+    int i, j, k;
+    double N = 0;
+
+    for(k=0; k<S->size; k++)
+    	if(S->keys[k] != -1)
+    		N = N + S->values[k];
+    for(k=0; k<S->size; k++)
+    	if(S->keys[k] != -1)
+    		S->values[k] = S->values[k]/N;
+
+    reserve_haralick_scratch(s, G, G);
+    double *Px = s->Px, *Py = s->Py, *Pxplusy = s->Pxplusy, *Pxminusy = s->Pxminusy;
+    double ux=0, uy=0, u, sx=0, sy=0;
+
+    for(i=0; i<G; i++)
+    {
+    	Px[i] = 0;
+    	Py[i] = 0;
+    	Pxminusy[i] = 0;
+    }
+    for(i=0; i<2*G-1; i++)
+    	Pxplusy[i] = 0;
+
+    for(k=0; k<S->size; k++)
+    {
+    	if(S->keys[k] == -1) continue;
+    	i = (int)(S->keys[k] / G);
+    	j = (int)(S->keys[k] % G);
+    	Px[i] = Px[i] + S->values[k];
+    	Py[j] = Py[j] + S->values[k];
+    	Pxplusy[i+j] = Pxplusy[i+j] + S->values[k];
+    	Pxminusy[(i>=j)? i-j:j-i] = Pxminusy[(i>=j)? i-j:j-i] + S->values[k];
+    }
+
+    for(i=0; i<G; i++)
+    {
+    	ux = ux + i*Px[i];
+    	uy = uy + i*Py[i];
+    }
+    u = 0.5*ux + 0.5*uy;
+    for(i=0; i<G; i++)
+    {
+    	sx = sx+Px[i]*(i-ux)*(i-ux);
+    	sy = sy+Py[i]*(i-uy)*(i-uy);
+    }
+    sx = sqrt(sx);
+    sy = sqrt(sy);
+
+    double HXY1=0, HXY2=0, HX=0, HY=0;
+    for(i=0; i<G; i++)
+    {
+    	HX = HX - Px[i]*log(Px[i]+0.00000001);
+    	HY = HY - Py[i]*log(Py[i]+0.00000001);
+    	if(Px[i]>0) HXY2 = HXY2 - Px[i]*log(Px[i]);
+    	if(Py[i]>0) HXY2 = HXY2 - Py[i]*log(Py[i]);
+    }
+
+    for(i=0; i<13; i++)
+        fx[i]=0;
+    for(k=0; k<S->size; k++)
+    {
+    	if(S->keys[k] == -1) continue;
+    	double p = S->values[k];
+    	i = (int)(S->keys[k] / G);
+    	j = (int)(S->keys[k] % G);
+    	HXY1 = HXY1 - p*log(Px[i]*Py[j] +0.00000001);
+    	fx[0] = fx[0] + p*p;
+    	if(i>j)
+    		fx[1] = fx[1] + p*(i-j)*(i-j);
+    	fx[2] = fx[2] + (i-ux)*(i-uy)*p/(sx*sy +0.00000001);
+    	fx[3] = fx[3] + (i-u)*(i-u)*p;
+    	fx[4] = fx[4] + p/(1+(double)(i-j)*(i-j));
+    	fx[8] = fx[8] - p*log(p+0.00000001);
+    }
+
+    for(i=0; i<2*G-1; i++)
+    {
+    	fx[5] = fx[5] + i*Pxplusy[i];
+    	fx[7] = fx[7] - Pxplusy[i]*log(Pxplusy[i]+0.00000001);
+    }
+    for(i=0; i<2*G-1; i++)
+    	fx[6] = fx[6] + (i-fx[5])*(i-fx[5])*Pxplusy[i];
+
+    /* fx[10] keeps the max_gray scaling of calculate_haralick_parameters */
+    double temp=0;
+    for(i=0; i<G; i++)
+    {
+    	temp = temp + i*Pxminusy[i];
+    	fx[10] = fx[10] - G*Pxminusy[i]*log(Pxminusy[i]+0.00000001);
+    }
+    for(i=0; i<G; i++)
+    	fx[9] = fx[9] + (i-temp)*(i-temp)*Pxminusy[i];
+
     double t;
     if(HX>HY) t=HX;
     else t=HY;
@@ -439,7 +1582,57 @@ double *calculate_haralick_parameters_RIVLBP(double **P, double fx[13], int m, i
     fx[12] = sqrt(1-exp(-2*(HXY2 - fx[8])));
 
     return fx;
+}
+
+/* To create a sparse co-occurance matrix and find its Haralick parameters
+ * Used for images with many gray levels (16 bit PGM) where the dense
+ * max_gray x max_gray matrix does not fit in memory
+ * Arguements: data: The PGM image
+ *             delta: The distance
+ *             angle: The config in degrees
+ */
+double *create_sparse_cooccurance_matrix(PGMData *data, int delta, int angle, double f[13])
+{
+    int delx, dely;
+    SparseGLCM S;
+    HaralickScratch s;
+    angle_to_displacement(delta, angle, &delx, &dely);
+
+    init_sparse_glcm(&S, data->max_gray, 1024);
+    fill_sparse_cooccurance_matrix(data, delx, dely, &S);
+    init_haralick_scratch(&s, data->max_gray);
+    calculate_haralick_parameters_sparse(&S, f, &s);
+    free_haralick_scratch(&s);
+    free_sparse_glcm(&S);
+    return f;
+}
+
 
+void write_haralick(int no, double *f, char *name, int n)
+{
+    FILE *train_file;
+    int i;
+    train_file = fopen(name, "ab");
+    if (train_file == NULL) {
+        perror("Cannot open file to write\n");
+        exit(EXIT_FAILURE);
+    }
+    fprintf(train_file,"%d ",no);
+    for(i=0; i<n; i++)
+    {
+    	fprintf(train_file,"%f ",f[i]);
+    }
+    fprintf(train_file,"\n");
+}
+
+
+double *calculate_haralick_parameters_RIVLBP(double **P, double fx[13], int m, int n)
+{
+    HaralickScratch s;
+    init_haralick_scratch(&s, 0);
+    haralick_kernel(P, m, n, HARALICK_ALL, fx, &s);
+    free_haralick_scratch(&s);
+    return fx;
 }
 
 void write_SVM_format(double f[], char name[], int clas, int n)
@@ -0,0 +1,287 @@
+/* Images with narrow pixel types
+ * Include after PGMlib.h and Haralicklib.h
+ *
+ * PGMData widens every pixel to an int. The images here keep 8 bit gray
+ * in a byte, 16 bit gray in two bytes and filter output in a float, so the
+ * kernels move a quarter (or half) of the memory. Each type is generated
+ * from one macro, which gives every kernel a copy compiled for its pixel
+ * type:
+ *   Image_u8   unsigned char   max_gray <= 255
+ *   Image_u16  unsigned short  max_gray <= 65535
+ *   Image_f32  float           convolution output
+ * The storage is the same single aligned block as allocate_dynamic_matrix,
+ * so img.pixels[x][y] works as for PGMData.
+ */
+
+/* Pixel types of a NarrowPGM */
+#define PIXEL_U8  0
+#define PIXEL_U16 1
+
+/* To declare an image type with its allocation and PGMData conversion
+ * Arguments: T: The pixel type
+ *            SFX: Suffix of the generated names
+ */
+#define DEFINE_IMAGE_TYPE(T, SFX)                                                   \
+typedef struct _Image_##SFX                                                        \
+{                                                                                  \
+    int width;      /* no of rows */                                               \
+    int height;     /* no of columns */                                            \
+    int max_gray;   /* max pixel value */                                          \
+    int stride;     /* no of pixels from the start of one row to the next */       \
+    T **pixels;     /* row pointers into one aligned block */                      \
+}Image_##SFX;                                                                      \
+                                                                                   \
+void allocate_image_##SFX(Image_##SFX *img, int width, int height, int max_gray)   \
+{                                                                                  \
+    char *block;                                                                   \
+    size_t head, row_bytes;                                                        \
+    int i;                                                                         \
+                                                                                   \
+    block = allocate_aligned_block(width, height, sizeof(T), &head, &row_bytes);  \
+    img->pixels = (T **)block;                                                     \
+    for (i = 0; i < width; ++i)                                                    \
+        img->pixels[i] = (T *)(block + head + row_bytes * i);                      \
+    img->width = width;                                                            \
+    img->height = height;                                                          \
+    img->max_gray = max_gray;                                                      \
+    img->stride = (int)(row_bytes / sizeof(T));                                    \
+}                                                                                  \
+                                                                                   \
+void free_image_##SFX(Image_##SFX *img)                                            \
+{                                                                                  \
+    free(img->pixels);                                                             \
+    img->pixels = NULL;                                                            \
+}                                                                                  \
+                                                                                   \
+/* To copy a PGM image into the narrow type; values must fit T */                 \
+void image_from_PGM_##SFX(PGMData *data, Image_##SFX *img)                         \
+{                                                                                  \
+    int i, j;                                                                      \
+    allocate_image_##SFX(img, data->width, data->height, data->max_gray);          \
+    for (i = 0; i < data->width; ++i)                                              \
+        for (j = 0; j < data->height; ++j)                                         \
+            img->pixels[i][j] = (T)data->pixels[i][j];                             \
+}                                                                                  \
+                                                                                   \
+/* To widen an image back to a PGM image, e.g. for writePGM */                    \
+PGMData PGM_from_image_##SFX(Image_##SFX *img)                                     \
+{                                                                                  \
+    PGMData data;                                                                  \
+    int i, j;                                                                      \
+    data.width = img->width;                                                       \
+    data.height = img->height;                                                     \
+    data.max_gray = img->max_gray;                                                 \
+    data.pixels = allocate_dynamic_matrix(img->width, img->height);                \
+    data.stride = PGM_STRIDE(img->height);                                         \
+    for (i = 0; i < img->width; ++i)                                               \
+        for (j = 0; j < img->height; ++j)                                          \
+            data.pixels[i][j] = (int)img->pixels[i][j];                            \
+    return data;                                                                   \
+}
+
+DEFINE_IMAGE_TYPE(unsigned char, u8)
+DEFINE_IMAGE_TYPE(unsigned short, u16)
+DEFINE_IMAGE_TYPE(float, f32)
+
+/* To declare the kernels of an image type
+ *   fill_cooccurance_counts_SFX   as fill_cooccurance_counts
+ *   calculate_LBP_SFX             as calculate_LBP, codes in an Image_u16
+ *   convolve_SFX                  as convolve, output in an Image_f32
+ */
+#define DEFINE_IMAGE_KERNELS(T, SFX)                                               \
+void fill_cooccurance_counts_##SFX(Image_##SFX *img, int delx, int dely, unsigned int **C) \
+{                                                                                  \
+    int x, y, a, b;                                                                \
+    int G = img->max_gray;                                                         \
+    GLCMOffset o = make_glcm_offset(delx, dely, img->width, img->height);          \
+                                                                                   \
+    for (a = 0; a < G; a++)                                                        \
+        for (b = 0; b < G; b++)                                                    \
+            C[a][b] = 0;                                                           \
+    for (x = o.xlo; x < o.xhi; x++)                                                \
+    {                                                                              \
+        T *row = img->pixels[x];                                                   \
+        T *next = img->pixels[x+delx] + dely;                                      \
+        for (y = o.ylo; y < o.yhi; y++)                                            \
+        {                                                                          \
+            a = (int)row[y];                                                       \
+            b = (int)next[y];                                                      \
+            if ((unsigned)a < (unsigned)G && (unsigned)b < (unsigned)G)            \
+                C[a][b]++;                                                         \
+        }                                                                          \
+    }                                                                              \
+}                                                                                  \
+                                                                                   \
+Image_u16 calculate_LBP_##SFX(Image_##SFX *img, int radius, int no_of_points)     \
+{                                                                                  \
+    Image_u16 result;                                                              \
+    double del_theta = 2*3.14159265/no_of_points;                                  \
+    int delx[16], dely[16];                                                        \
+    int i, j, k, p, jdash, kdash, code, max = 0;                                   \
+                                                                                   \
+    if (no_of_points > 16)                                                         \
+    {                                                                              \
+        fprintf(stderr, "Narrow LBP supports at most 16 points!\n");              \
+        exit(1);                                                                   \
+    }                                                                              \
+    for (p = 0; p < no_of_points; p++)                                             \
+    {                                                                              \
+        dely[p] = (int)ceil(sin(del_theta*p)*radius);                              \
+        delx[p] = (int)ceil(cos(del_theta*p)*radius);                              \
+    }                                                                              \
+    allocate_image_u16(&result, (img->width-2*radius)/(2*radius+1),                \
+                       (img->height-2*radius)/(2*radius+1), 0);                    \
+    for (i = 0; i < result.width; i++)                                             \
+    {                                                                              \
+        j = radius + i*(2*radius+1);                                               \
+        for (k = radius; k < radius + result.height*(2*radius+1); k += 2*radius+1) \
+        {                                                                          \
+            T centre = img->pixels[j][k];                                          \
+            code = 0;                                                              \
+            for (p = 0; p < no_of_points; p++)                                     \
+            {                                                                      \
+                jdash = (j+delx[p] >= 0 && j+delx[p] < img->width)? j+delx[p] : j; \
+                kdash = (k+dely[p] >= 0 && k+dely[p] < img->height)? k+dely[p] : k; \
+                code = (code << 1) | (img->pixels[jdash][kdash] > centre);         \
+            }                                                                      \
+            result.pixels[i][(k-radius)/(2*radius+1)] = (unsigned short)code;      \
+            if (code > max)                                                        \
+                max = code;                                                        \
+        }                                                                          \
+    }                                                                              \
+    result.max_gray = max;                                                         \
+    return result;                                                                 \
+}                                                                                  \
+                                                                                   \
+Image_f32 convolve_##SFX(Image_##SFX *in, double **coeffs, int K)                  \
+{                                                                                  \
+    Image_f32 out;                                                                 \
+    float c[K*K];                                                                  \
+    int i, j, ii, jj;                                                              \
+                                                                                   \
+    for (ii = 0; ii < K; ++ii)                                                     \
+        for (jj = 0; jj < K; ++jj)                                                 \
+            c[ii*K + jj] = (float)coeffs[ii][jj];                                  \
+    allocate_image_f32(&out, in->width-K+1, in->height-K+1, in->max_gray);         \
+    for (i = 0; i < out.width; ++i)                                                \
+    {                                                                              \
+        float *dst = out.pixels[i];                                                \
+        for (j = 0; j < out.height; ++j)                                           \
+            dst[j] = 0;                                                            \
+        for (ii = 0; ii < K; ++ii)                                                 \
+        {                                                                          \
+            T *src = in->pixels[i+ii];                                             \
+            for (jj = 0; jj < K; ++jj)                                             \
+            {                                                                      \
+                float w = c[ii*K + jj];                                            \
+                for (j = 0; j < out.height; ++j)                                   \
+                    dst[j] += w * (float)src[j+jj];                                \
+            }                                                                      \
+        }                                                                          \
+    }                                                                              \
+    return out;                                                                    \
+}
+
+DEFINE_IMAGE_KERNELS(unsigned char, u8)
+DEFINE_IMAGE_KERNELS(unsigned short, u16)
+DEFINE_IMAGE_KERNELS(float, f32)
+
+/* A PGM image read at its native width */
+typedef struct _NarrowPGM
+{
+    int type;           // PIXEL_U8 or PIXEL_U16
+    Image_u8 u8;        // used when type is PIXEL_U8
+    Image_u16 u16;      // used when type is PIXEL_U16
+}NarrowPGM;
+
+/* To read a PGM file into 8 bit storage if max_gray <= 255, else 16 bit
+ * Arguments: file_name: The PGM file, P2 or P5
+ *            img: Empty object to store the image into
+ */
+NarrowPGM* readPGM_narrow(const char *file_name, NarrowPGM *img)
+{
+    FILE *pgm_file;
+    char version[3];
+    char ver;
+    int width, height, max_gray;
+    int i, j, value;
+
+    pgm_file = fopen(file_name, "rb");
+    if (pgm_file == NULL)
+    {
+        perror("Cannot open file\n");
+        exit(1);
+    }
+    fgets(version, sizeof(version), pgm_file);
+    if (!strcmp(version, "P5"))
+        ver = 1;
+    else if(!strcmp(version,"P2"))
+       	ver = 0;
+    else
+    {
+    	fprintf(stderr, "Wrong file type!\n");
+        exit(1);
+    }
+
+    skip_comments(pgm_file);
+    fscanf(pgm_file, "%d", &height);
+    skip_comments(pgm_file);
+    fscanf(pgm_file, "%d", &width);
+    skip_comments(pgm_file);
+    fscanf(pgm_file, "%d", &max_gray);
+    fgetc(pgm_file);
+
+    if (max_gray > 255)
+    {
+        img->type = PIXEL_U16;
+        allocate_image_u16(&img->u16, width, height, max_gray);
+    }
+    else
+    {
+        img->type = PIXEL_U8;
+        allocate_image_u8(&img->u8, width, height, max_gray);
+    }
+
+    /* P5 is read in one go and the rows copied out at native width */
+    if (ver)
+    {
+        unsigned char *raster = read_P5_raster(pgm_file, width, height, max_gray);
+        for (i = 0; i < width; ++i)
+        {
+            if (img->type == PIXEL_U8)
+                memcpy(img->u8.pixels[i], raster + (size_t)i * height, height);
+            else
+            {
+                memcpy(img->u16.pixels[i], raster + (size_t)i * height * 2, (size_t)height * 2);
+                big_endian_to_host_16(img->u16.pixels[i], height);
+            }
+        }
+        free(raster);
+    }
+    else
+    {
+        PGMTokenizer tok;
+        init_pgm_tokenizer(&tok, pgm_file);
+        for (i = 0; i < width; ++i)
+            for (j = 0; j < height; ++j)
+            {
+                value = next_P2_pixel(&tok, max_gray, file_name);
+                if (img->type == PIXEL_U8)
+                    img->u8.pixels[i][j] = (unsigned char)value;
+                else
+                    img->u16.pixels[i][j] = (unsigned short)value;
+            }
+        free_pgm_tokenizer(&tok);
+    }
+
+    fclose(pgm_file);
+    return img;
+}
+
+void free_narrow_pgm(NarrowPGM *img)
+{
+    if (img->type == PIXEL_U8)
+        free_image_u8(&img->u8);
+    else
+        free_image_u16(&img->u16);
+}
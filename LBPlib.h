@@ -129,6 +129,7 @@ PGMData calculate_LBP(PGMData *data, int radius, int no_of_points)
 	result.max_gray = max;
 
 	result.pixels = allocate_dynamic_matrix(data->width, data->height);
+	result.stride = PGM_STRIDE(data->height);
 	for(i=0; i<result.width; i++)
 	{
 		for(j=0; j<result.height; j++)
@@ -196,6 +197,7 @@ PGMData calculate_LBPriu2(PGMData *data, int radius, int no_of_points)
 	result.max_gray = no_of_points+2;
 
 	result.pixels = allocate_dynamic_matrix(data->width, data->height);
+	result.stride = PGM_STRIDE(data->height);
 	for(i=0; i<result.width; i++)
 	{
 		for(j=0; j<result.height; j++)
@@ -276,6 +278,7 @@ double *calculate_completed_LBP(PGMData *data, int radius, int no_of_points, dou
 	result.max_gray = data->max_gray;
 
 	result.pixels = allocate_dynamic_matrix(result.width, result.height);
+	result.stride = PGM_STRIDE(result.height);
 
 	for(i=0; i<result.width; i++)
 	{
@@ -294,6 +297,7 @@ double *calculate_completed_LBP(PGMData *data, int radius, int no_of_points, dou
 	result.max_gray = data->max_gray;
 
 	result.pixels = allocate_dynamic_matrix(result.width, result.height);
+	result.stride = PGM_STRIDE(result.height);
 
 	for(i=0; i<result.width; i++)
 	{
@@ -313,6 +317,7 @@ double *calculate_completed_LBP(PGMData *data, int radius, int no_of_points, dou
 	result.max_gray = data->max_gray;
 
 	result.pixels = allocate_dynamic_matrix(result.width, result.height);
+	result.stride = PGM_STRIDE(result.height);
 
 	for(i=0; i<result.width; i++)
 	{
@@ -400,6 +405,7 @@ double *calculate_CoALBP(PGMData *data, int radius, int no_of_points, double f[1
     result.max_gray = max;
 //    printf("\nMax = %d\n",max);
     result.pixels = allocate_dynamic_matrix(result.width, result.height);
+    result.stride = PGM_STRIDE(result.height);
 	for(j=0; j<(data->width - 2*radius)/(2*radius+1)-1; j++)
 	{
 		for(k=0; k<(data->height - 2*radius)/(2*radius+1)-1; k++)
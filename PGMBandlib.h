@@ -0,0 +1,297 @@
+/* Streaming a PGM file in bands of rows
+ * Include after PGMlib.h and Haralicklib.h
+ *
+ * The reader holds band_rows rows of the image plus a halo of rows above
+ * and below, and never more, so images larger than memory can be handled.
+ * Each call of next_PGM_band slides the window down: the rows still
+ * needed as halo are moved to the top and the rest is read from the file.
+ * The extractors below only consider pixels whose anchor lies in the core
+ * rows of the band, so adding up the bands gives the whole image result.
+ */
+
+/* Structure of a band reader */
+typedef struct _PGMBandReader
+{
+    FILE *fp;
+    char ver;               // 1 for P5, 0 for P2
+    const char *file_name;
+    int rows;               // no of rows of the image
+    int cols;               // no of columns of the image
+    int max_gray;
+    int band_rows;          // no of core rows per band
+    int halo;               // no of extra rows kept on each side
+    int next_row;           // next row of the file to be read
+    PGMData band;           // the resident rows; band.width is their no
+    int first_row;          // row of the image held in band.pixels[0]
+    int core_lo, core_hi;   // rows of the image the band is responsible for
+    unsigned char *raster;  // P5 read buffer
+    PGMTokenizer *tok;      // P2 tokenizer
+}PGMBandReader;
+
+/* To open a PGM file for reading in bands
+ * Arguments: file_name: The PGM file, P2 or P5
+ *            band_rows: No of rows each band is responsible for
+ *            halo: No of rows of context above and below a band
+ *            r: Empty reader
+ */
+PGMBandReader* open_PGM_bands(const char *file_name, int band_rows, int halo, PGMBandReader *r)
+{
+    char version[3];
+
+    r->fp = fopen(file_name, "rb");
+    if (r->fp == NULL)
+    {
+        perror("Cannot open file\n");
+        exit(1);
+    }
+    fgets(version, sizeof(version), r->fp);
+    if (!strcmp(version, "P5"))
+        r->ver = 1;
+    else if(!strcmp(version,"P2"))
+       	r->ver = 0;
+    else
+    {
+    	fprintf(stderr, "Wrong file type!\n");
+        exit(1);
+    }
+    skip_comments(r->fp);
+    fscanf(r->fp, "%d", &r->cols);
+    skip_comments(r->fp);
+    fscanf(r->fp, "%d", &r->rows);
+    skip_comments(r->fp);
+    fscanf(r->fp, "%d", &r->max_gray);
+    fgetc(r->fp);
+
+    if (band_rows < 1)
+        band_rows = 1;
+    r->file_name = file_name;
+    r->band_rows = band_rows;
+    r->halo = halo;
+    r->next_row = 0;
+    r->first_row = 0;
+    r->core_lo = r->core_hi = 0;
+    r->band.width = 0;
+    r->band.height = r->cols;
+    r->band.max_gray = r->max_gray;
+    r->band.pixels = allocate_dynamic_matrix(band_rows + 2*halo, r->cols);
+    r->band.stride = PGM_STRIDE(r->cols);
+    r->raster = NULL;
+    r->tok = NULL;
+    if (r->ver)
+        r->raster = (unsigned char *)malloc((size_t)(band_rows + 2*halo) * r->cols * ((r->max_gray > 255)? 2 : 1) + 1);
+    else
+    {
+        r->tok = (PGMTokenizer *)malloc(sizeof(PGMTokenizer));
+        if (r->tok != NULL)
+            init_pgm_tokenizer(r->tok, r->fp);
+    }
+    if (r->raster == NULL && r->tok == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+    return r;
+}
+
+void close_PGM_bands(PGMBandReader *r)
+{
+    fclose(r->fp);
+    deallocate_dynamic_matrix(r->band.pixels, r->band.width);
+    free(r->raster);
+    if (r->tok != NULL)
+        free_pgm_tokenizer(r->tok);
+    free(r->tok);
+}
+
+/* To read the next n rows of the file into rows dst.. of the band */
+void read_PGM_band_rows(PGMBandReader *r, int dst, int n)
+{
+    int i, j;
+    if (r->ver)
+    {
+        int two = (r->max_gray > 255);
+        size_t bytes = (size_t)n * r->cols * (two? 2 : 1);
+        if (fread(r->raster, 1, bytes, r->fp) != bytes)
+        {
+            fprintf(stderr, "%s: PGM file is truncated!\n", r->file_name);
+            exit(1);
+        }
+        for (i = 0; i < n; ++i)
+        {
+            int *row = r->band.pixels[dst+i];
+            if (two)
+            {
+                unsigned char *src = r->raster + (size_t)i * r->cols * 2;
+                for (j = 0; j < r->cols; ++j)
+                    row[j] = (src[2*j] << 8) | src[2*j+1];
+            }
+            else
+            {
+                unsigned char *src = r->raster + (size_t)i * r->cols;
+                for (j = 0; j < r->cols; ++j)
+                    row[j] = src[j];
+            }
+        }
+    }
+    else
+        for (i = 0; i < n; ++i)
+            for (j = 0; j < r->cols; ++j)
+                r->band.pixels[dst+i][j] = next_P2_pixel(r->tok, r->max_gray, r->file_name);
+    r->next_row += n;
+}
+
+/* To move to the next band
+ * On return band.pixels[0..band.width) hold rows first_row.. of the
+ * image, covering the core rows [core_lo, core_hi) and up to halo rows on
+ * each side of them (fewer at the top and bottom of the image).
+ * Returns 0 when the whole image has been visited
+ */
+int next_PGM_band(PGMBandReader *r)
+{
+    int keep, want_lo, want_hi;
+    if (r->core_hi >= r->rows)
+        return 0;
+
+    r->core_lo = r->core_hi;
+    r->core_hi = r->core_lo + r->band_rows;
+    if (r->core_hi > r->rows)
+        r->core_hi = r->rows;
+    want_lo = r->core_lo - r->halo;
+    want_hi = r->core_hi + r->halo;
+    if (want_lo < 0)
+        want_lo = 0;
+    if (want_hi > r->rows)
+        want_hi = r->rows;
+
+    /* Rows of the last band that are still needed move to the top */
+    keep = r->first_row + r->band.width - want_lo;
+    if (keep > 0)
+        memmove(r->band.pixels[0], r->band.pixels[r->band.width - keep], sizeof(int) * (size_t)keep * r->band.stride);
+    else
+        keep = 0;
+    r->first_row = want_lo;
+    read_PGM_band_rows(r, keep, want_hi - r->next_row);
+    r->band.width = want_hi - want_lo;
+    return 1;
+}
+
+/* To add the co-occurance pairs anchored in the core rows of a band
+ * The halo must be at least |delx|. Over all the bands the counts add up
+ * to fill_cooccurance_counts of the whole image
+ * Arguments: r: The band reader, after next_PGM_band
+ *            delx, dely: The displacement of the neighbour
+ *            C: max_gray x max_gray matrix to add the counts to, 64 bit as
+ *               a bin of a whole slide image can pass 2^32
+ */
+void add_cooccurance_counts_band(PGMBandReader *r, int delx, int dely, unsigned long long **C)
+{
+    int x, y, a, b;
+    int G = r->max_gray;
+    GLCMOffset o = make_glcm_offset(delx, dely, r->rows, r->cols);
+    int lo = (r->core_lo > o.xlo)? r->core_lo : o.xlo;
+    int hi = (r->core_hi < o.xhi)? r->core_hi : o.xhi;
+
+    if (abs(delx) > r->halo)
+    {
+        fprintf(stderr, "Band halo is smaller than the displacement!\n");
+        exit(1);
+    }
+    for (x = lo; x < hi; x++)
+    {
+        int *row = r->band.pixels[x - r->first_row];
+        int *next = r->band.pixels[x + delx - r->first_row] + dely;
+        for (y = o.ylo; y < o.yhi; y++)
+        {
+            a = row[y];
+            b = next[y];
+            if((unsigned)a < (unsigned)G && (unsigned)b < (unsigned)G)
+                C[a][b]++;
+        }
+    }
+}
+
+/* To find the Haralick parameters of a PGM file read in bands
+ * Gives the same result as create_cooccurance_counts on the whole image
+ * Arguements: file_name: The PGM file
+ *             band_rows: No of rows per band
+ *             delta: The distance
+ *             angle: The config in degrees
+ */
+double *create_cooccurance_counts_banded(const char *file_name, int band_rows, int delta, int angle, double f[13])
+{
+    int i, j, delx, dely;
+    PGMBandReader r;
+    HaralickScratch s;
+    unsigned long long **C;
+    angle_to_displacement(delta, angle, &delx, &dely);
+
+    open_PGM_bands(file_name, band_rows, abs(delx), &r);
+    C = allocate_dynamic_matrix_ull(r.max_gray, r.max_gray);
+    for(i=0;i<r.max_gray;i++)
+    	for(j=0;j<r.max_gray;j++)
+    		C[i][j]=0;
+    while (next_PGM_band(&r))
+        add_cooccurance_counts_band(&r, delx, dely, C);
+
+    init_haralick_scratch(&s, r.max_gray);
+    calculate_haralick_parameters_counts64(C, r.max_gray, f, &s);
+    free_haralick_scratch(&s);
+    deallocate_dynamic_matrix_ull(C, r.max_gray);
+    close_PGM_bands(&r);
+    return f;
+}
+
+/* To add the LBP codes of the centres in the core rows of a band to a
+ * histogram. The centres and codes are those of calculate_LBP, so over all
+ * the bands hist counts the pixels of the calculate_LBP image.
+ * The halo must be at least radius
+ * Arguments: r: The band reader, after next_PGM_band
+ *            radius, no_of_points: As for calculate_LBP
+ *            hist: 2^no_of_points bins to add to
+ */
+void add_LBP_histogram_band(PGMBandReader *r, int radius, int no_of_points, long long *hist)
+{
+    double del_theta = 2*3.14159265/no_of_points;
+    int step = 2*radius + 1;
+    int n_rows = (r->rows - 2*radius)/step;
+    int n_cols = (r->cols - 2*radius)/step;
+    int i, j, k, p, jdash, kdash, code;
+    int *delx = (int *)malloc(sizeof(int) * no_of_points);
+    int *dely = (int *)malloc(sizeof(int) * no_of_points);
+    if (delx == NULL || dely == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+    if (radius > r->halo)
+    {
+        fprintf(stderr, "Band halo is smaller than the LBP radius!\n");
+        exit(1);
+    }
+    for (p = 0; p < no_of_points; p++)
+    {
+        dely[p] = (int)ceil(sin(del_theta*p)*radius);
+        delx[p] = (int)ceil(cos(del_theta*p)*radius);
+    }
+
+    /* First centre row at or after core_lo */
+    i = (r->core_lo > radius)? (r->core_lo - radius + step - 1)/step : 0;
+    for (; i < n_rows && radius + i*step < r->core_hi; i++)
+    {
+        j = radius + i*step;
+        for (k = radius; k < radius + n_cols*step; k += step)
+        {
+            int centre = r->band.pixels[j - r->first_row][k];
+            code = 0;
+            for (p = 0; p < no_of_points; p++)
+            {
+                jdash = (j+delx[p] >= 0 && j+delx[p] < r->rows)? j+delx[p] : j;
+                kdash = (k+dely[p] >= 0 && k+dely[p] < r->cols)? k+dely[p] : k;
+                code = (code << 1) | (r->band.pixels[jdash - r->first_row][kdash] > centre);
+            }
+            hist[code]++;
+        }
+    }
+    free(delx);
+    free(dely);
+}
@@ -0,0 +1,218 @@
+/* Packs of many PGM images in one file
+ * Include after PGMlib.h and PGMViewlib.h
+ *
+ * Layout, all integers little endian:
+ *   0   "PGMPACK1"
+ *   8   uint32 no of images
+ *   12  uint32 0
+ *   16  index, PGM_PACK_ENTRY bytes per image:
+ *         uint64 offset of the raster from the start of the file
+ *         uint32 no of rows, uint32 no of columns
+ *         uint32 max_gray,   uint32 bytes per pixel (1 or 2)
+ *         uint64 0
+ *   rasters as in P5 (16 bit values big endian), each starting on a
+ *   PGM_ALIGN byte boundary
+ * A pack is opened and mapped once; any image is then a view into the
+ * mapping found in O(1) from its index entry.
+ */
+
+#define PGM_PACK_MAGIC "PGMPACK1"
+#define PGM_PACK_HEADER 16
+#define PGM_PACK_ENTRY 32
+
+/* Structure of an open pack */
+typedef struct _PGMPack
+{
+    int count;                      // no of images
+    const unsigned char *index;     // first index entry
+    void *map;
+    size_t map_size;
+}PGMPack;
+
+void put_le32(unsigned char *p, unsigned int v)
+{
+    p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF; p[2] = (v >> 16) & 0xFF; p[3] = (v >> 24) & 0xFF;
+}
+
+void put_le64(unsigned char *p, unsigned long long v)
+{
+    put_le32(p, (unsigned int)(v & 0xFFFFFFFFu));
+    put_le32(p + 4, (unsigned int)(v >> 32));
+}
+
+unsigned int get_le32(const unsigned char *p)
+{
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+unsigned long long get_le64(const unsigned char *p)
+{
+    return (unsigned long long)get_le32(p) | ((unsigned long long)get_le32(p + 4) << 32);
+}
+
+/* To write bytes to a pack, exiting if they are not all written */
+void write_pack_bytes(FILE *fp, const void *buf, size_t bytes)
+{
+    if (fwrite(buf, 1, bytes, fp) != bytes)
+    {
+        perror("Cannot write file");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* To pack PGM files into one file
+ * The images are read one at a time, so memory holds one image and the index
+ * Arguments: out_name: The pack to create
+ *            n: No of images
+ *            file_names: The PGM files, P2 or P5
+ */
+void pack_PGM_files(const char *out_name, int n, const char **file_names)
+{
+    static const unsigned char zeros[PGM_ALIGN];
+    unsigned char header[PGM_PACK_HEADER];
+    unsigned char *index = (unsigned char *)calloc((size_t)n * PGM_PACK_ENTRY + 1, 1);
+    unsigned long long offset = PGM_PACK_HEADER + (unsigned long long)n * PGM_PACK_ENTRY;
+    FILE *fp = fopen(out_name, "wb");
+    PGMData data;
+    int k;
+
+    if (fp == NULL)
+    {
+        perror("Cannot open file to write");
+        exit(EXIT_FAILURE);
+    }
+    if (index == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+    memcpy(header, PGM_PACK_MAGIC, 8);
+    put_le32(header + 8, (unsigned int)n);
+    put_le32(header + 12, 0);
+    write_pack_bytes(fp, header, PGM_PACK_HEADER);
+    write_pack_bytes(fp, index, (size_t)n * PGM_PACK_ENTRY);
+
+    for (k = 0; k < n; k++)
+    {
+        unsigned char *entry = index + (size_t)k * PGM_PACK_ENTRY;
+        size_t pad = (size_t)((PGM_ALIGN - offset % PGM_ALIGN) % PGM_ALIGN);
+        size_t bytes;
+        unsigned char *raster;
+
+        readPGM(file_names[k], &data);
+        bytes = (size_t)data.width * data.height * ((data.max_gray > 255)? 2 : 1);
+        raster = (unsigned char *)malloc(bytes + 1);
+        if (raster == NULL)
+        {
+            perror("Memory allocation failure");
+            exit(1);
+        }
+        encode_P5_raster(&data, raster);
+        write_pack_bytes(fp, zeros, pad);
+        offset += pad;
+        write_pack_bytes(fp, raster, bytes);
+
+        put_le64(entry, offset);
+        put_le32(entry + 8, (unsigned int)data.width);
+        put_le32(entry + 12, (unsigned int)data.height);
+        put_le32(entry + 16, (unsigned int)data.max_gray);
+        put_le32(entry + 20, (data.max_gray > 255)? 2 : 1);
+        put_le64(entry + 24, 0);
+        offset += bytes;
+
+        free(raster);
+        deallocate_dynamic_matrix(data.pixels, data.width);
+    }
+
+    /* The index is only known now; write it over the placeholder */
+    if (fseek(fp, PGM_PACK_HEADER, SEEK_SET) != 0)
+    {
+        perror("Cannot write file");
+        exit(EXIT_FAILURE);
+    }
+    write_pack_bytes(fp, index, (size_t)n * PGM_PACK_ENTRY);
+    if (fclose(fp) != 0)
+    {
+        perror("Cannot write file");
+        exit(EXIT_FAILURE);
+    }
+    free(index);
+}
+
+/* To open a pack for reading
+ * Arguments: file_name: The pack
+ *            pack: Empty object to store the pack into
+ *            advice: PGM_MAP_* hints for the kernel
+ */
+PGMPack* open_PGM_pack(const char *file_name, PGMPack *pack, int advice)
+{
+    struct stat st;
+    const unsigned char *base;
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        perror("Cannot open file\n");
+        exit(1);
+    }
+    pack->map_size = (size_t)st.st_size;
+    if (pack->map_size < PGM_PACK_HEADER)
+    {
+        fprintf(stderr, "%s: Not a PGM pack!\n", file_name);
+        exit(1);
+    }
+    pack->map = mmap(NULL, pack->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pack->map == MAP_FAILED)
+    {
+        perror("Cannot map file\n");
+        exit(1);
+    }
+    base = (const unsigned char *)pack->map;
+    pack->count = (int)get_le32(base + 8);
+    pack->index = base + PGM_PACK_HEADER;
+    if (memcmp(base, PGM_PACK_MAGIC, 8) != 0 || pack->count < 0 ||
+        (pack->map_size - PGM_PACK_HEADER) / PGM_PACK_ENTRY < (size_t)pack->count)
+    {
+        fprintf(stderr, "%s: Not a PGM pack!\n", file_name);
+        exit(1);
+    }
+    if (advice & PGM_MAP_SEQUENTIAL)
+        madvise(pack->map, pack->map_size, MADV_SEQUENTIAL);
+    if (advice & PGM_MAP_WILLNEED)
+        madvise(pack->map, pack->map_size, MADV_WILLNEED);
+    return pack;
+}
+
+void close_PGM_pack(PGMPack *pack)
+{
+    munmap(pack->map, pack->map_size);
+    pack->map = NULL;
+    pack->index = NULL;
+}
+
+/* To get image k of a pack as a view into the mapping
+ * The view stays valid until close_PGM_pack and must not be unmapped
+ * Returns view, or NULL if k is out of range or its entry is corrupt
+ */
+PGMView* get_PGM_pack_view(PGMPack *pack, int k, PGMView *view)
+{
+    const unsigned char *entry;
+    unsigned long long offset, bytes;
+    if (k < 0 || k >= pack->count)
+        return NULL;
+    entry = pack->index + (size_t)k * PGM_PACK_ENTRY;
+    offset = get_le64(entry);
+    view->width = (int)get_le32(entry + 8);
+    view->height = (int)get_le32(entry + 12);
+    view->max_gray = (int)get_le32(entry + 16);
+    view->bytes = (int)get_le32(entry + 20);
+    view->stride = view->height;
+    bytes = (unsigned long long)view->width * view->height * view->bytes;
+    if (view->width < 0 || view->height < 0 || (view->bytes != 1 && view->bytes != 2) ||
+        offset > pack->map_size || bytes > pack->map_size - offset)
+        return NULL;
+    view->pixels = (const unsigned char *)pack->map + offset;
+    view->map = NULL;
+    view->map_size = 0;
+    return view;
+}
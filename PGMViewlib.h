@@ -0,0 +1,210 @@
+/* Read-only views of P5 images mapped straight from the file
+ * Include after PGMlib.h and Haralicklib.h
+ *
+ * mapPGM mmaps a P5 file and points the view at the raster inside the
+ * mapping, so no copy or pixel allocation is made; the pages come from
+ * the page cache as the extractor touches them. Pixels stay as stored:
+ * one byte each, or two big endian bytes when max_gray > 255.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Access hints for mapPGM, may be or'ed */
+#define PGM_MAP_NORMAL     0
+#define PGM_MAP_SEQUENTIAL 1    // the raster will be read front to back
+#define PGM_MAP_WILLNEED   2    // start reading the raster in now
+
+/* Structure of a view */
+typedef struct _PGMView
+{
+    int width;                      // no of rows
+    int height;                     // no of columns
+    int max_gray;                   // max pixel value
+    int stride;                     // no of pixels from one row to the next
+    int bytes;                      // bytes per pixel, 1 or 2
+    const unsigned char *pixels;    // first pixel of the raster
+    void *map;                      // the mapping, NULL if the view does not own one
+    size_t map_size;
+}PGMView;
+
+/* Value of pixel (x,y) of a view */
+#define PGM_VIEW_PIXEL(v,x,y) ((v)->bytes == 1 ? \
+    (int)(v)->pixels[(size_t)(x)*(v)->stride + (y)] : \
+    (((int)(v)->pixels[2*((size_t)(x)*(v)->stride + (y))] << 8) | (v)->pixels[2*((size_t)(x)*(v)->stride + (y))+1]))
+
+/* To skip white space and # comments in a header held in memory */
+size_t skip_comments_mem(const unsigned char *buf, size_t pos, size_t size)
+{
+    while (pos < size)
+    {
+        if (buf[pos] == '#')
+            while (pos < size && buf[pos] != '\n')
+                pos++;
+        else if (isspace(buf[pos]))
+            pos++;
+        else
+            break;
+    }
+    return pos;
+}
+
+/* To read a non negative decimal from a header held in memory
+ * Returns the position after it, or 0 if there is no number there or it
+ * does not fit an int
+ */
+size_t read_header_int(const unsigned char *buf, size_t pos, size_t size, int *value)
+{
+    size_t start;
+    long long v = 0;
+    *value = 0;
+    pos = skip_comments_mem(buf, pos, size);
+    start = pos;
+    while (pos < size && buf[pos] >= '0' && buf[pos] <= '9')
+    {
+        v = v * 10 + (buf[pos++] - '0');
+        if (v > 0x7FFFFFFF)
+            return 0;
+    }
+    *value = (int)v;
+    return (pos == start)? 0 : pos;
+}
+
+/* To parse the header of a PGM file held in memory
+ * Arguments: buf, size: The file contents
+ *            view: Gets width, height, max_gray, stride and bytes
+ * Returns the offset of the raster, or 0 if buf is not a valid P5 file
+ */
+size_t parse_P5_header(const unsigned char *buf, size_t size, PGMView *view)
+{
+    size_t pos = 2;
+    if (size < 2 || buf[0] != 'P' || buf[1] != '5')
+        return 0;
+    if ((pos = read_header_int(buf, pos, size, &view->height)) == 0)
+        return 0;
+    if ((pos = read_header_int(buf, pos, size, &view->width)) == 0)
+        return 0;
+    if ((pos = read_header_int(buf, pos, size, &view->max_gray)) == 0)
+        return 0;
+    /* A single white space character ends the header */
+    if (pos >= size || !isspace(buf[pos]))
+        return 0;
+    pos++;
+    view->stride = view->height;
+    view->bytes = (view->max_gray > 255)? 2 : 1;
+    if (size - pos < (size_t)view->width * view->height * view->bytes)
+        return 0;
+    return pos;
+}
+
+/* To map a P5 file as a read-only view
+ * Arguments: file_name: The PGM file
+ *            view: Empty object to store the view into
+ *            advice: PGM_MAP_* hints for the kernel
+ * Returns view, or NULL if the file is not a complete P5 file (P2 files
+ * have to go through readPGM)
+ */
+PGMView* mapPGM(const char *file_name, PGMView *view, int advice)
+{
+    struct stat st;
+    size_t offset;
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0)
+    {
+        perror("Cannot open file\n");
+        exit(1);
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+    view->map_size = (size_t)st.st_size;
+    view->map = mmap(NULL, view->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view->map == MAP_FAILED)
+    {
+        perror("Cannot map file\n");
+        exit(1);
+    }
+
+    offset = parse_P5_header((const unsigned char *)view->map, view->map_size, view);
+    if (offset == 0)
+    {
+        munmap(view->map, view->map_size);
+        view->map = NULL;
+        return NULL;
+    }
+    view->pixels = (const unsigned char *)view->map + offset;
+
+    if (advice & PGM_MAP_SEQUENTIAL)
+        madvise(view->map, view->map_size, MADV_SEQUENTIAL);
+    if (advice & PGM_MAP_WILLNEED)
+        madvise(view->map, view->map_size, MADV_WILLNEED);
+    return view;
+}
+
+void unmapPGM(PGMView *view)
+{
+    if (view->map != NULL)
+        munmap(view->map, view->map_size);
+    view->map = NULL;
+    view->pixels = NULL;
+}
+
+/* To copy a view into a PGM image, for the extractors that need PGMData */
+PGMData* view_to_PGM(PGMView *view, PGMData *data)
+{
+    int i, j;
+    data->width = view->width;
+    data->height = view->height;
+    data->max_gray = view->max_gray;
+    data->pixels = allocate_dynamic_matrix(data->width, data->height);
+    data->stride = PGM_STRIDE(data->height);
+    for (i = 0; i < view->width; ++i)
+        for (j = 0; j < view->height; ++j)
+            data->pixels[i][j] = PGM_VIEW_PIXEL(view, i, j);
+    return data;
+}
+
+/* To fill an integer co-occurance matrix straight from a view
+ * Counts the same pairs as fill_cooccurance_counts
+ * Arguments: view: The image
+ *            delx, dely: The displacement of the neighbour
+ *            C: max_gray x max_gray matrix to store the counts into
+ */
+void fill_cooccurance_counts_view(PGMView *view, int delx, int dely, unsigned int **C)
+{
+    int x, y, a, b;
+    int G = view->max_gray;
+    GLCMOffset o = make_glcm_offset(delx, dely, view->width, view->height);
+
+    for (a = 0; a < G; a++)
+        for (b = 0; b < G; b++)
+            C[a][b] = 0;
+    for (x = o.xlo; x < o.xhi; x++)
+    {
+        if (view->bytes == 1)
+        {
+            const unsigned char *row = view->pixels + (size_t)x * view->stride;
+            const unsigned char *next = view->pixels + (size_t)(x+delx) * view->stride + dely;
+            for (y = o.ylo; y < o.yhi; y++)
+            {
+                a = row[y];
+                b = next[y];
+                if (a < G && b < G)
+                    C[a][b]++;
+            }
+        }
+        else
+            for (y = o.ylo; y < o.yhi; y++)
+            {
+                a = PGM_VIEW_PIXEL(view, x, y);
+                b = PGM_VIEW_PIXEL(view, x+delx, y+dely);
+                if (a < G && b < G)
+                    C[a][b]++;
+            }
+    }
+}
@@ -40,6 +40,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 /* To get the upper 8 bits of a number */
 #define UP8(num) (((num) & 0x0000FF00) >> 8)
@@ -53,32 +56,56 @@ typedef struct _PGMData
     int height;      // no of columns (height)
     int max_gray; // max pixel value
     int **pixels; // The 2D array containing all pixel values
+    int stride;   // no of ints from the start of one row to the next
 }PGMData;
 
-/*Dynamically allocate memory size for the matrix to store pixel values
- * Total size = row * col
+/* Rows of every matrix start on a PGM_ALIGN byte boundary */
+#define PGM_ALIGN 64
+/* Bytes per row of n values of the given size, padded to PGM_ALIGN */
+#define PGM_ROW_BYTES(n, size) ((((size_t)(n)*(size) + PGM_ALIGN-1)/PGM_ALIGN)*PGM_ALIGN)
+/* Row stride in pixels of an image of the given height */
+#define PGM_STRIDE(height) ((int)(PGM_ROW_BYTES(height, sizeof(int))/sizeof(int)))
+/* Pixel (x,y) addressed through the contiguous buffer */
+#define PGM_PIXEL(data,x,y) ((data)->pixels[0][(size_t)(x)*(data)->stride + (y)])
+
+/* To allocate the single block behind a matrix
+ * The block holds the array of row pointers followed by the rows, each
+ * padded to a multiple of PGM_ALIGN bytes, so the whole matrix is one
+ * aligned buffer walked with a fixed stride. It is freed with one free().
+ * Arguments: width: No of rows
+ *            height: No of values in a row
+ *            size: Size of a value
+ *            head: Returns the offset of the first row
+ *            row_bytes: Returns the stride in bytes
  */
-int **allocate_dynamic_matrix(int width, int height)
+char *allocate_aligned_block(int width, int height, size_t size, size_t *head, size_t *row_bytes)
 {
-    int **ret_val;
-    int i;
-
-    ret_val = (int **)malloc(sizeof(int *) * width);
-    if (ret_val == NULL)
+    void *block;
+    *head = PGM_ROW_BYTES(width, sizeof(void *));
+    *row_bytes = PGM_ROW_BYTES(height, size);
+    if (posix_memalign(&block, PGM_ALIGN, *head + *row_bytes * (size_t)width) != 0)
     {
         perror("Memory allocation failure");
         exit(1);
     }
+    return (char *)block;
+}
 
+/*Dynamically allocate memory size for the matrix to store pixel values
+ * Total size = row * stride, in a single aligned block; mat[i] still
+ * points at row i so the matrix is indexed as mat[i][j]
+ */
+int **allocate_dynamic_matrix(int width, int height)
+{
+    int **ret_val;
+    char *block;
+    size_t head, row_bytes;
+    int i;
+
+    block = allocate_aligned_block(width, height, sizeof(int), &head, &row_bytes);
+    ret_val = (int **)block;
     for (i = 0; i < width; ++i)
-    {
-        ret_val[i] = (int *)malloc(sizeof(int) * height);
-        if (ret_val[i] == NULL)
-        {
-            perror("Memory allocation failure");
-            exit(1);
-        }
-    }
+        ret_val[i] = (int *)(block + head + row_bytes * i);
 
     return ret_val;
 }
@@ -87,24 +114,44 @@ int **allocate_dynamic_matrix(int width, int height)
 double **allocate_dynamic_matrix_double(int width, int height)
 {
     double **ret_val;
+    char *block;
+    size_t head, row_bytes;
     int i;
 
-    ret_val = (double **)malloc(sizeof(double *) * width);
-    if (ret_val == NULL)
-    {
-        perror("Memory allocation failure");
-        exit(1);
-    }
+    block = allocate_aligned_block(width, height, sizeof(double), &head, &row_bytes);
+    ret_val = (double **)block;
+    for (i = 0; i < width; ++i)
+        ret_val[i] = (double *)(block + head + row_bytes * i);
+
+    return ret_val;
+}
 
+unsigned int **allocate_dynamic_matrix_uint(int width, int height)
+{
+    unsigned int **ret_val;
+    char *block;
+    size_t head, row_bytes;
+    int i;
+
+    block = allocate_aligned_block(width, height, sizeof(unsigned int), &head, &row_bytes);
+    ret_val = (unsigned int **)block;
     for (i = 0; i < width; ++i)
-    {
-        ret_val[i] = (double *)malloc(sizeof(double) * height);
-        if (ret_val[i] == NULL)
-        {
-            perror("Memory allocation failure");
-            exit(1);
-        }
-    }
+        ret_val[i] = (unsigned int *)(block + head + row_bytes * i);
+
+    return ret_val;
+}
+
+unsigned long long **allocate_dynamic_matrix_ull(int width, int height)
+{
+    unsigned long long **ret_val;
+    char *block;
+    size_t head, row_bytes;
+    int i;
+
+    block = allocate_aligned_block(width, height, sizeof(unsigned long long), &head, &row_bytes);
+    ret_val = (unsigned long long **)block;
+    for (i = 0; i < width; ++i)
+        ret_val[i] = (unsigned long long *)(block + head + row_bytes * i);
 
     return ret_val;
 }
@@ -124,26 +171,27 @@ double *allocate_dynamic_vector(int width)
     return ret_val;
 }
 /* Deallocate memory for the matrix
- * Total size = row * col
+ * The rows share one block, so row is no longer needed
  */
 void deallocate_dynamic_matrix(int **mat, int row)
 {
-    int i;
-
-    for (i = 0; i < row; ++i)
-        free(mat[i]);
     free(mat);
 }
 
 void deallocate_dynamic_matrix_double(double **mat, int row)
 {
-    int i;
+    free(mat);
+}
 
-    for (i = 0; i < row; ++i)
-        free(mat[i]);
+void deallocate_dynamic_matrix_uint(unsigned int **mat, int row)
+{
     free(mat);
 }
 
+void deallocate_dynamic_matrix_ull(unsigned long long **mat, int row)
+{
+    free(mat);
+}
 
 void deallocate_dynamic_vector(double *mat, int row)
 {
@@ -171,6 +219,145 @@ void skip_comments(FILE *fp)
         fseek(fp, -1, SEEK_CUR);
 }
 
+/* Size of the blocks the P2 tokenizer reads */
+#define PGM_TOKEN_BUFFER 65536
+
+/* Buffered reader of the decimal values of a P2 raster
+ * The buffer lives on the heap so readers stay usable on small worker
+ * thread stacks; release it with free_pgm_tokenizer
+ */
+typedef struct _PGMTokenizer
+{
+    FILE *fp;
+    size_t pos, len;        // next byte and no of bytes in buf
+    unsigned char *buf;     // PGM_TOKEN_BUFFER bytes
+}PGMTokenizer;
+
+void init_pgm_tokenizer(PGMTokenizer *t, FILE *fp)
+{
+    t->fp = fp;
+    t->pos = 0;
+    t->len = 0;
+    t->buf = (unsigned char *)malloc(PGM_TOKEN_BUFFER);
+    if (t->buf == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+}
+
+void free_pgm_tokenizer(PGMTokenizer *t)
+{
+    free(t->buf);
+    t->buf = NULL;
+}
+
+/* Next byte of the stream, or EOF */
+int pgm_tokenizer_getc(PGMTokenizer *t)
+{
+    if (t->pos == t->len)
+    {
+        t->len = fread(t->buf, 1, PGM_TOKEN_BUFFER, t->fp);
+        t->pos = 0;
+        if (t->len == 0)
+            return EOF;
+    }
+    return t->buf[t->pos++];
+}
+
+/* To read the next value, skipping white space and # comments
+ * Returns 1 on success, 0 at the end of the stream and -1 if the next
+ * token is not a non negative decimal
+ */
+int next_pgm_int(PGMTokenizer *t, int *value)
+{
+    int ch = pgm_tokenizer_getc(t);
+    long long v = 0;
+
+    for (;;)
+    {
+        if (ch == '#')
+            while (ch != '\n' && ch != EOF)
+                ch = pgm_tokenizer_getc(t);
+        else if (ch != EOF && isspace(ch))
+            ch = pgm_tokenizer_getc(t);
+        else
+            break;
+    }
+    if (ch == EOF)
+        return 0;
+    if (ch < '0' || ch > '9')
+        return -1;
+    while (ch >= '0' && ch <= '9')
+    {
+        v = v * 10 + (ch - '0');
+        if (v > 0x7FFFFFFF)
+            return -1;
+        ch = pgm_tokenizer_getc(t);
+    }
+    /* The value must end at white space, a comment or the end */
+    if (ch == '#')
+        t->pos--;
+    else if (ch != EOF && !isspace(ch))
+        return -1;
+    *value = (int)v;
+    return 1;
+}
+
+/* To read the next pixel of a P2 raster, stopping on malformed input */
+int next_P2_pixel(PGMTokenizer *t, int max_gray, const char *file_name)
+{
+    int value;
+    int ret = next_pgm_int(t, &value);
+    if (ret == 0)
+    {
+        fprintf(stderr, "%s: P2 data ends before the last pixel!\n", file_name);
+        exit(1);
+    }
+    if (ret < 0 || value > max_gray)
+    {
+        fprintf(stderr, "%s: Malformed P2 pixel value!\n", file_name);
+        exit(1);
+    }
+    return value;
+}
+
+/* To read the whole P5 raster of an image with a single fread
+ * The file must be positioned at the first pixel. Values are left as
+ * stored: one byte each, or two big endian bytes when max_gray > 255.
+ * Returns a malloc'd buffer of width*height values
+ */
+unsigned char *read_P5_raster(FILE *fp, int width, int height, int max_gray)
+{
+    size_t bytes = (size_t)width * height * ((max_gray > 255)? 2 : 1);
+    unsigned char *raster = (unsigned char *)malloc(bytes ? bytes : 1);
+    if (raster == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+    if (fread(raster, 1, bytes, fp) != bytes)
+    {
+        fprintf(stderr, "PGM file is truncated!\n");
+        exit(1);
+    }
+    return raster;
+}
+
+/* To turn n big endian 16 bit values into host order in place
+ * A plain shift loop, which the compiler turns into vector shuffles;
+ * nothing to do on a big endian host
+ */
+void big_endian_to_host_16(unsigned short *v, size_t n)
+{
+    const unsigned short one = 1;
+    size_t k;
+    if (*(const unsigned char *)&one == 0)
+        return;
+    for (k = 0; k < n; ++k)
+        v[k] = (unsigned short)((v[k] << 8) | (v[k] >> 8));
+}
+
 /* To read a PGM file given a filename and storage space*/
 PGMData* readPGM(const char *file_name, PGMData *data)
 {
@@ -178,7 +365,6 @@ PGMData* readPGM(const char *file_name, PGMData *data)
     char version[3];    // To get the version P2 or P5
     char ver;           // Flag for version
     int i, j;           // Counters/ Iteration variables
-    int lower, upper;   // To read the upper 8 bits and lower 8 bits
 
     /* Opening file*/
     pgm_file = fopen(file_name, "rb");
@@ -213,116 +399,337 @@ PGMData* readPGM(const char *file_name, PGMData *data)
 
     /* Allocating memory dynamically */
     data->pixels = allocate_dynamic_matrix(data->width, data->height);
+    data->stride = PGM_STRIDE(data->height);
 
-    /* If version is P5, reading the values as binary */
+    /* If version is P5, reading the values as binary in one read */
     if(ver)
     {
+        unsigned char *raster = read_P5_raster(pgm_file, data->width, data->height, data->max_gray);
         if (data->max_gray > 255)
             for (i = 0; i < data->width; ++i)
+            {
+                unsigned char *src = raster + (size_t)i * data->height * 2;
+                int *dst = data->pixels[i];
                 for (j = 0; j < data->height; ++j)
-                {
-                    upper = fgetc(pgm_file);
-                    lower = fgetc(pgm_file);
-                    data->pixels[i][j] = (upper << 8) + lower;
-                }
+                    dst[j] = (src[2*j] << 8) | src[2*j+1];
+            }
         else
             for (i = 0; i < data->width; ++i)
+            {
+                unsigned char *src = raster + (size_t)i * data->height;
+                int *dst = data->pixels[i];
                 for (j = 0; j < data->height; ++j)
-                {
-                    lower = fgetc(pgm_file);
-                    data->pixels[i][j] = lower;
-                }
+                    dst[j] = src[j];
+            }
+        free(raster);
     }
 
-    /* If version is P2 reading values as ASCII */
+    /* If version is P2 reading values as ASCII, a block at a time */
     else
     {
+        PGMTokenizer tok;
+        init_pgm_tokenizer(&tok, pgm_file);
         for (i = 0; i < data->width; ++i)
             for (j = 0; j < data->height; ++j)
-                fscanf(pgm_file, "%d", &data->pixels[i][j]);
+                data->pixels[i][j] = next_P2_pixel(&tok, data->max_gray, file_name);
+        free_pgm_tokenizer(&tok);
     }
 
     fclose(pgm_file);
     return data;
 }
 
+/* Modes of requantisation */
+#define QUANT_LINEAR          0   // equal width bins over 0..max_gray
+#define QUANT_EQUAL_FREQUENCY 1   // bins holding equal no of pixels (histogram equalised)
+#define QUANT_EDGES           2   // user supplied bin edges
+
+/* To build the look up table mapping the gray values 0..max_gray to 0..levels-1
+ * Arguments: data: The PGM image (only read for QUANT_EQUAL_FREQUENCY)
+ *            levels: No of output levels
+ *            mode: One of the QUANT_ modes
+ *            edges: For QUANT_EDGES, levels-1 increasing edges; value v goes
+ *                   to the no of edges <= v. Ignored otherwise
+ * Returns a table of max_gray+1 entries, to be freed by the caller
+ */
+int *make_quantisation_table(PGMData *data, int levels, int mode, const int *edges)
+{
+    int i, j, v;
+    int G = data->max_gray;
+    int *lut = (int *)malloc(sizeof(int) * (G+1));
+    if (lut == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+
+    if(mode == QUANT_EQUAL_FREQUENCY)
+    {
+        long long total = 0, below = 0;
+        long long *hist = (long long *)calloc(G+1, sizeof(long long));
+        if (hist == NULL)
+        {
+            perror("Memory allocation failure");
+            exit(1);
+        }
+        for(i=0; i<data->width; i++)
+            for(j=0; j<data->height; j++)
+            {
+                v = data->pixels[i][j];
+                v = (v < 0)? 0:(v > G)? G:v;
+                hist[v]++;
+            }
+        total = (long long)data->width * data->height;
+        for(v=0; v<=G; v++)
+        {
+            lut[v] = (total > 0)? (int)(below * levels / total):0;
+            below = below + hist[v];
+        }
+        free(hist);
+    }
+    else if(mode == QUANT_EDGES)
+    {
+        j = 0;
+        for(v=0; v<=G; v++)
+        {
+            while(j < levels-1 && edges[j] <= v)
+                j++;
+            lut[v] = j;
+        }
+    }
+    else
+    {
+        for(v=0; v<=G; v++)
+            lut[v] = (int)((long long)v * levels / (G+1));
+    }
+    return lut;
+}
+
+/* To map every pixel of src through the table into dst
+ * Values outside 0..max_gray are clamped first.
+ * Arguments: src, dst: images of the same size, may be the same image
+ */
+void apply_quantisation_table(PGMData *src, PGMData *dst, const int *lut)
+{
+    int i, j, v;
+    int G = src->max_gray;
+    for(i=0; i<src->width; i++)
+    {
+        int *in = src->pixels[i];
+        int *out = dst->pixels[i];
+        for(j=0; j<src->height; j++)
+        {
+            v = in[j];
+            v = (v < 0)? 0:v;
+            v = (v > G)? G:v;
+            out[j] = lut[v];
+        }
+    }
+}
+
+/* To requantise an image to the given no of levels in place
+ * max_gray is set to levels, so the co-occurance matrix of the result
+ * has one row per level.
+ */
+PGMData* quantisePGM(PGMData *data, int levels, int mode, const int *edges)
+{
+    int *lut = make_quantisation_table(data, levels, mode, edges);
+    apply_quantisation_table(data, data, lut);
+    data->max_gray = levels;
+    free(lut);
+    return data;
+}
+
+/* To requantise a copy of an image, leaving the original untouched
+ * so each extractor can run at its own no of levels
+ */
+PGMData copy_quantisePGM(PGMData *data, int levels, int mode, const int *edges)
+{
+    PGMData result;
+    int *lut = make_quantisation_table(data, levels, mode, edges);
+    result.width = data->width;
+    result.height = data->height;
+    result.max_gray = levels;
+    result.pixels = allocate_dynamic_matrix(data->width, data->height);
+    result.stride = PGM_STRIDE(data->height);
+    apply_quantisation_table(data, &result, lut);
+    free(lut);
+    return result;
+}
+
 /* Normalize all values to given value */
 PGMData* normalisePGM(PGMData *data, int value)
 {
-	int i, j;
-	if(value>data->max_gray)
-	    for(i=0; i<data->width; i++)
-		    for(j=0; j<data->height; j++)
-			    data->pixels[i][j]*=(value/data->max_gray);
-
-	else
-		for(i=0; i<data->width; i++)
-		    for(j=0; j<data->height; j++)
-			    data->pixels[i][j]/=(data->max_gray/value);
+	int v;
+	int *lut = (int *)malloc(sizeof(int) * (data->max_gray+1));
+	if (lut == NULL)
+	{
+		perror("Memory allocation failure");
+		exit(1);
+	}
+	for(v=0; v<=data->max_gray; v++)
+		lut[v] = (int)((long long)v * value / data->max_gray);
+	apply_quantisation_table(data, data, lut);
+	free(lut);
 
 	data->max_gray = value;
 //	printf("Successfully read file\n");
 	return data;
 }
 
-/* To write a structure into a PGM file */
-void writePGM(const char *filename, PGMData *data, char ver)
-{
-    FILE *pgm_file;
-    int i, j;
-    int hi, lo;
+/* P2 lines are kept within this many characters */
+#define PGM_P2_LINE 70
 
-    pgm_file = fopen(filename, "wb");
-    if (pgm_file == NULL) {
-        perror("Cannot open file to write");
-        exit(EXIT_FAILURE);
-    }
+/* To write the decimal digits of v at p, returns the no of characters */
+int pgm_itoa(int v, unsigned char *p)
+{
+    unsigned char tmp[12];
+    unsigned int u = (v < 0)? 0u - (unsigned int)v : (unsigned int)v;
+    int n = 0, len = 0;
+    do
+    {
+        tmp[n++] = (unsigned char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (v < 0)
+        p[len++] = '-';
+    while (n)
+        p[len++] = tmp[--n];
+    return len;
+}
 
+/* Size of a buffer that holds the encoded file (an upper bound for P2) */
+size_t PGM_encoded_size(PGMData *data, char ver)
+{
+    size_t n = (size_t)data->width * data->height;
+    int i, j, lo = 0, hi = 0;
+    unsigned char digits[12];
     if (ver)
-        fprintf(pgm_file, "P5 ");
+        return 64 + n * ((data->max_gray > 255)? 2 : 1);
+    for (i = 0; i < data->width; ++i)
+        for (j = 0; j < data->height; ++j)
+        {
+            if (data->pixels[i][j] < lo) lo = data->pixels[i][j];
+            if (data->pixels[i][j] > hi) hi = data->pixels[i][j];
+        }
+    if (pgm_itoa(lo, digits) > pgm_itoa(hi, digits))
+        hi = lo;
+    return 64 + n * (pgm_itoa(hi, digits) + 1);
+}
+
+/* To encode the pixels of an image as a P5 raster, without the header
+ * Rows are narrowed to one or two big endian bytes in tight loops the
+ * compiler vectorises.
+ * Returns the no of bytes written to buf
+ */
+size_t encode_P5_raster(PGMData *data, unsigned char *buf)
+{
+    unsigned char *p = buf;
+    int i, j;
+    if (data->max_gray > 255)
+        for (i = 0; i < data->width; ++i, p += 2 * (size_t)data->height)
+        {
+            int *src = data->pixels[i];
+            for (j = 0; j < data->height; ++j)
+            {
+                p[2*j] = (unsigned char)UP8(src[j]);
+                p[2*j+1] = (unsigned char)LO8(src[j]);
+            }
+        }
     else
-    	fprintf(pgm_file, "P2 ");
-    fprintf(pgm_file, "%d %d ", data->height, data->width);
-    fprintf(pgm_file, "%d ", data->max_gray);
+        for (i = 0; i < data->width; ++i, p += data->height)
+        {
+            int *src = data->pixels[i];
+            for (j = 0; j < data->height; ++j)
+                p[j] = (unsigned char)LO8(src[j]);
+        }
+    return (size_t)(p - buf);
+}
+
+/* To encode an image as a PGM file in memory
+ * P5 rasters come from encode_P5_raster; P2 values are written by
+ * pgm_itoa, with lines wrapped before PGM_P2_LINE characters as the
+ * format requires.
+ * Arguments: data: The image
+ *            ver: 1 for P5, 0 for P2
+ *            buf: At least PGM_encoded_size(data, ver) bytes
+ * Returns the no of bytes written
+ */
+size_t encode_PGM(PGMData *data, char ver, unsigned char *buf)
+{
+    unsigned char *p = buf;
+    int i, j;
+
+    p += sprintf((char *)p, "%s %d %d %d%c", ver? "P5" : "P2", data->height, data->width, data->max_gray, ver? ' ' : '\n');
 
     if(ver)
+        p += encode_P5_raster(data, p);
+    else
     {
-        if (data->max_gray > 255)
-        {
-            for (i = 0; i < data->width; ++i)
+        unsigned char digits[12];
+        int line = 0, len;
+        for (i = 0; i < data->width; ++i)
+            for (j = 0; j < data->height; ++j)
             {
-                for (j = 0; j < data->height; ++j)
+                len = pgm_itoa(data->pixels[i][j], digits);
+                if (line && line + 1 + len > PGM_P2_LINE)
                 {
-                    hi = UP8(data->pixels[i][j]);
-                    lo = LO8(data->pixels[i][j]);
-                    fputc(hi, pgm_file);
-                    fputc(lo, pgm_file);
+                    *p++ = '\n';
+                    line = 0;
                 }
-            }
-        }
-        else
-        {
-            for (i = 0; i < data->width; ++i)
-                for (j = 0; j < data->height; ++j)
+                else if (line)
                 {
-                    lo = LO8(data->pixels[i][j]);
-                    fputc(lo, pgm_file);
+                    *p++ = ' ';
+                    line++;
                 }
-        }
+                memcpy(p, digits, len);
+                p += len;
+                line += len;
+            }
+        *p++ = '\n';
     }
+    return (size_t)(p - buf);
+}
 
-    else
+/* To write a structure to an open file descriptor with one write call
+ * (more only if the system writes part of the buffer)
+ */
+void writePGM_fd(int fd, PGMData *data, char ver)
+{
+    unsigned char *buf = (unsigned char *)malloc(PGM_encoded_size(data, ver));
+    size_t size, done = 0;
+    ssize_t ret;
+    if (buf == NULL)
     {
-    	for (i = 0; i < data->width; ++i)
-    	{
-    	    for (j = 0; j < data->height; ++j)
-    	        {
-    	    	    fprintf(pgm_file,"%d ",data->pixels[i][j]);
-    	        }
-    	}
+        perror("Memory allocation failure");
+        exit(1);
+    }
+    size = encode_PGM(data, ver, buf);
+    while (done < size)
+    {
+        ret = write(fd, buf + done, size - done);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+        {
+            perror("Cannot write file");
+            exit(EXIT_FAILURE);
+        }
+        done += (size_t)ret;
+    }
+    free(buf);
+}
 
+/* To write a structure into a PGM file */
+void writePGM(const char *filename, PGMData *data, char ver)
+{
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("Cannot open file to write");
+        exit(EXIT_FAILURE);
     }
-    fclose(pgm_file);
+    writePGM_fd(fd, data, ver);
+    close(fd);
     //deallocate_dynamic_matrix(data->pixels, data->row);
 }
 
@@ -340,6 +747,7 @@ PGMData make_PGM(double **pixels, int width, int height)
 	}
 	PGMData write;
 	write.pixels = allocate_dynamic_matrix(width, height);
+	write.stride = PGM_STRIDE(height);
 	write.width = width;
 	write.height = height;
 	write.max_gray = 512;
@@ -0,0 +1,293 @@
+/* Reading PNG files straight into PGMData
+ * Include after PGMlib.h; link with -lpng
+ *
+ * Gray and gray+alpha images keep their own depth: 1, 2, 4 and 8 bit gray
+ * give max_gray 1, 3, 15 and 255, and 16 bit gray gives 65535, with the
+ * alpha channel dropped. Colour images (RGB, RGBA, palette) are turned
+ * into luma while decoding when asked to, with the Rec. 601 weights
+ *   Y = 0.299 R + 0.587 G + 0.114 B
+ * in fixed point, one row at a time, so the colour image never exists in
+ * full.
+ */
+
+#include <png.h>
+
+/* Options of readPNG */
+#define PNG_GRAY_ONLY 0     // colour images are an error
+#define PNG_TO_LUMA   1     // colour images are converted to luma
+
+/* To turn a row of 8 bit RGB into luma
+ * Integer weights summing to 256, in a loop the compiler vectorises
+ * Arguments: src: n pixels of channels bytes, R G B first
+ *            dst: n luma values
+ */
+void rgb8_to_luma(const unsigned char *src, int channels, int *dst, int n)
+{
+    int j;
+    for (j = 0; j < n; ++j)
+    {
+        const unsigned char *px = src + (size_t)j * channels;
+        dst[j] = (77 * px[0] + 150 * px[1] + 29 * px[2] + 128) >> 8;
+    }
+}
+
+/* As rgb8_to_luma for 16 bit big endian samples, weights summing to 65536 */
+void rgb16_to_luma(const unsigned char *src, int channels, int *dst, int n)
+{
+    int j;
+    for (j = 0; j < n; ++j)
+    {
+        const unsigned char *px = src + (size_t)j * channels * 2;
+        unsigned int r = (px[0] << 8) | px[1];
+        unsigned int g = (px[2] << 8) | px[3];
+        unsigned int b = (px[4] << 8) | px[5];
+        dst[j] = (int)(((unsigned long long)19595 * r + 38470ull * g + 7471ull * b + 32768) >> 16);
+    }
+}
+
+/* To turn a decoded row into a row of PGMData pixels */
+void png_row_to_pixels(const unsigned char *src, int *dst, int n, int channels, int bit_depth, int colour)
+{
+    int j;
+    if (colour)
+    {
+        if (bit_depth == 16)
+            rgb16_to_luma(src, channels, dst, n);
+        else
+            rgb8_to_luma(src, channels, dst, n);
+    }
+    else if (bit_depth == 16)
+        for (j = 0; j < n; ++j)
+            dst[j] = (src[2*j*channels] << 8) | src[2*j*channels+1];
+    else
+        for (j = 0; j < n; ++j)
+            dst[j] = src[j*channels];
+}
+
+/* To read a PNG file into a PGM image
+ * Arguments: file_name: The PNG file
+ *            data: Empty object to store the image into
+ *            options: PNG_GRAY_ONLY or PNG_TO_LUMA
+ */
+PGMData* readPNG(const char *file_name, PGMData *data, int options)
+{
+    FILE *fp;
+    png_structp png;
+    png_infop info;
+    int bit_depth, color_type, channels, colour, passes, i;
+    size_t row_bytes;
+    unsigned char *buffer = NULL;
+    unsigned char **rows = NULL;
+
+    fp = fopen(file_name, "rb");
+    if (fp == NULL)
+    {
+        perror("Cannot open file\n");
+        exit(1);
+    }
+    png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    info = (png == NULL)? NULL : png_create_info_struct(png);
+    if (info == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+    if (setjmp(png_jmpbuf(png)))
+    {
+        fprintf(stderr, "%s: Cannot decode PNG file!\n", file_name);
+        exit(1);
+    }
+
+    png_init_io(png, fp);
+    png_read_info(png, info);
+    bit_depth = png_get_bit_depth(png, info);
+    color_type = png_get_color_type(png, info);
+
+    /* Gray below 8 bits is unpacked to a byte a pixel, keeping its values */
+    if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8)
+        png_set_packing(png);
+    if (color_type == PNG_COLOR_TYPE_PALETTE)
+    {
+        png_set_palette_to_rgb(png);
+        bit_depth = 8;
+    }
+    colour = (color_type & PNG_COLOR_MASK_COLOR) != 0;
+    if (colour && options != PNG_TO_LUMA)
+    {
+        fprintf(stderr, "%s: PNG file is not gray!\n", file_name);
+        exit(1);
+    }
+    passes = png_set_interlace_handling(png);
+    png_read_update_info(png, info);
+    channels = png_get_channels(png, info);
+    row_bytes = png_get_rowbytes(png, info);
+
+    data->height = (int)png_get_image_width(png, info);
+    data->width = (int)png_get_image_height(png, info);
+    data->max_gray = (1 << bit_depth) - 1;
+    data->pixels = allocate_dynamic_matrix(data->width, data->height);
+    data->stride = PGM_STRIDE(data->height);
+
+    /* Interlaced images need the whole image before any row is final */
+    buffer = (unsigned char *)malloc(row_bytes * ((passes > 1)? (size_t)data->width : 1) + 1);
+    if (passes > 1)
+        rows = (unsigned char **)malloc(sizeof(unsigned char *) * data->width + 1);
+    if (buffer == NULL || (passes > 1 && rows == NULL))
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+    if (passes > 1)
+    {
+        for (i = 0; i < data->width; ++i)
+            rows[i] = buffer + row_bytes * i;
+        png_read_image(png, rows);
+        for (i = 0; i < data->width; ++i)
+            png_row_to_pixels(rows[i], data->pixels[i], data->height, channels, bit_depth, colour);
+    }
+    else
+        for (i = 0; i < data->width; ++i)
+        {
+            png_read_row(png, buffer, NULL);
+            png_row_to_pixels(buffer, data->pixels[i], data->height, channels, bit_depth, colour);
+        }
+
+    png_read_end(png, NULL);
+    png_destroy_read_struct(&png, &info, NULL);
+    free(buffer);
+    free(rows);
+    fclose(fp);
+    return data;
+}
+
+/* Structure of a PNG image in flight
+ * Everything about one image lives here, so different images can be read,
+ * processed and written on different threads at once. The row pointers
+ * and the pixels share one aligned allocation.
+ */
+typedef struct _PNGContext
+{
+    int width;                  // no of columns
+    int height;                 // no of rows
+    png_byte color_type;        // as in the file
+    png_byte bit_depth;         // as in the file
+    size_t row_bytes;           // bytes per row of the 8 bit RGBA pixels
+    png_bytep *row_pointers;    // start of the block, then the rows
+}PNGContext;
+
+/* To read any PNG file into 8 bit RGBA pixels held by ctx */
+PNGContext* read_png_context(const char *filename, PNGContext *ctx)
+{
+    FILE *fp;
+    png_structp png;
+    png_infop info;
+    char *block;
+    size_t head, stride;
+    int y;
+
+    fp = fopen(filename, "rb");
+    if (fp == NULL)
+    {
+        perror("Cannot open file\n");
+        exit(1);
+    }
+    png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    info = (png == NULL)? NULL : png_create_info_struct(png);
+    if (info == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+    if (setjmp(png_jmpbuf(png)))
+    {
+        fprintf(stderr, "%s: Cannot decode PNG file!\n", filename);
+        exit(1);
+    }
+
+    png_init_io(png, fp);
+    png_read_info(png, info);
+
+    ctx->width      = png_get_image_width(png, info);
+    ctx->height     = png_get_image_height(png, info);
+    ctx->color_type = png_get_color_type(png, info);
+    ctx->bit_depth  = png_get_bit_depth(png, info);
+
+    // Read any color_type into 8bit depth, RGBA format.
+    // See http://www.libpng.org/pub/png/libpng-manual.txt
+    if (ctx->bit_depth == 16)
+        png_set_strip_16(png);
+    if (ctx->color_type == PNG_COLOR_TYPE_PALETTE)
+        png_set_palette_to_rgb(png);
+    // PNG_COLOR_TYPE_GRAY_ALPHA is always 8 or 16bit depth.
+    if (ctx->color_type == PNG_COLOR_TYPE_GRAY && ctx->bit_depth < 8)
+        png_set_expand_gray_1_2_4_to_8(png);
+    if (png_get_valid(png, info, PNG_INFO_tRNS))
+        png_set_tRNS_to_alpha(png);
+    // These color_type don't have an alpha channel then fill it with 0xff.
+    if (ctx->color_type == PNG_COLOR_TYPE_RGB ||
+        ctx->color_type == PNG_COLOR_TYPE_GRAY ||
+        ctx->color_type == PNG_COLOR_TYPE_PALETTE)
+        png_set_filler(png, 0xFF, PNG_FILLER_AFTER);
+    if (ctx->color_type == PNG_COLOR_TYPE_GRAY ||
+        ctx->color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
+        png_set_gray_to_rgb(png);
+    png_set_interlace_handling(png);
+    png_read_update_info(png, info);
+
+    /* One block: the row pointers, then the rows */
+    ctx->row_bytes = png_get_rowbytes(png, info);
+    block = allocate_aligned_block(ctx->height, (int)ctx->row_bytes, 1, &head, &stride);
+    ctx->row_pointers = (png_bytep *)block;
+    for (y = 0; y < ctx->height; y++)
+        ctx->row_pointers[y] = (png_bytep)(block + head + stride * y);
+
+    png_read_image(png, ctx->row_pointers);
+    png_read_end(png, NULL);
+    png_destroy_read_struct(&png, &info, NULL);
+    fclose(fp);
+    return ctx;
+}
+
+/* To write the 8 bit RGBA pixels of ctx to a PNG file */
+void write_png_context(const char *filename, PNGContext *ctx)
+{
+    FILE *fp;
+    png_structp png;
+    png_infop info;
+
+    fp = fopen(filename, "wb");
+    if (fp == NULL)
+    {
+        perror("Cannot open file to write");
+        exit(EXIT_FAILURE);
+    }
+    png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    info = (png == NULL)? NULL : png_create_info_struct(png);
+    if (info == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+    if (setjmp(png_jmpbuf(png)))
+    {
+        fprintf(stderr, "%s: Cannot encode PNG file!\n", filename);
+        exit(1);
+    }
+
+    png_init_io(png, fp);
+    // Output is 8bit depth, RGBA format.
+    png_set_IHDR(png, info, ctx->width, ctx->height, 8,
+                 PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    png_write_image(png, ctx->row_pointers);
+    png_write_end(png, NULL);
+    png_destroy_write_struct(&png, &info);
+    fclose(fp);
+}
+
+void free_png_context(PNGContext *ctx)
+{
+    free(ctx->row_pointers);
+    ctx->row_pointers = NULL;
+}
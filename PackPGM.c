@@ -0,0 +1,22 @@
+/* Program to pack many PGM files into one file
+ * Usage: PackPGM pack_file image1.pgm image2.pgm ...
+ * The images are read back with open_PGM_pack and get_PGM_pack_view
+ */
+
+#include "PGMlib.h"
+#include "Haralicklib.h"
+#include "PGMViewlib.h"
+#include "PGMPacklib.h"
+
+int main(int argc, char *argv[])
+{
+    if(argc<3)
+    {
+    	fprintf(stderr, "Usage: %s pack_file image1.pgm [image2.pgm ...]\n", argv[0]);
+    	exit(1);
+    }
+
+    pack_PGM_files(argv[1], argc-2, (const char **)(argv+2));
+    printf("Packed %d images into %s\n", argc-2, argv[1]);
+    return 0;
+}
@@ -132,6 +132,7 @@ int calculate_keypoints(PGMData *data, int o, int *key_loc, double *key_mag)
 		temp.height = data->height;
 		temp.max_gray = data->max_gray;
 		temp.pixels = allocate_dynamic_matrix(temp.width, temp.height);
+		temp.stride = PGM_STRIDE(temp.height);
 		for(i=0; i<temp.width; i++)
 		{
 			for(j=0; j<temp.width; j++)
@@ -276,6 +277,7 @@ int calculate_keypoints_mod(PGMData *data, int o, int *key_loc, double *key_mag)
 		temp.height = data->height;
 		temp.max_gray = data->max_gray;
 		temp.pixels = allocate_dynamic_matrix(temp.width, temp.height);
+		temp.stride = PGM_STRIDE(temp.height);
 		for(i=0; i<temp.width; i++)
 		{
 			for(j=0; j<temp.width; j++)
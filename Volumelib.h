@@ -0,0 +1,251 @@
+/* Co-occurance matrix and Haralick parameters of volumes of PGM slices */
+/* Include after PGMlib.h and Haralicklib.h */
+
+/* Structure of a volume
+ * The slices are stored one after the other in a single block
+ */
+typedef struct _PGMVolume
+{
+    int width;      // no of rows of a slice
+    int height;     // no of columns of a slice
+    int depth;      // no of slices
+    int max_gray;   // max pixel value
+    int *voxels;    // depth*width*height values, slice after slice
+}PGMVolume;
+
+/* Value of voxel (x,y) of slice z */
+#define VOXEL(v,z,x,y) ((v)->voxels[((long long)(z)*(v)->width + (x))*(v)->height + (y)])
+
+/* No of distinct 3D directions */
+#define VOLUME_DIRECTIONS 13
+
+/* The 13 directions of unit length (dz, dx, dy); the first four are the
+ * in-slice 0, 45, 90 and 135 degree configs, the other nine reach into
+ * the next slice
+ */
+static const int volume_direction[VOLUME_DIRECTIONS][3] =
+{
+    {0, 0, 1}, {0,-1, 1}, {0,-1, 0}, {0,-1,-1},
+    {1, 0, 0}, {1,-1, 0}, {1, 1, 0}, {1, 0, 1}, {1, 0,-1},
+    {1,-1, 1}, {1, 1,-1}, {1,-1,-1}, {1, 1, 1}
+};
+
+/* To read a list of PGM slices into a volume
+ * All the slices must have the same size and max gray value
+ */
+PGMVolume* readPGMVolume(const char **file_names, int n, PGMVolume *vol)
+{
+    int z, x;
+    PGMData slice;
+
+    for(z=0; z<n; z++)
+    {
+        readPGM(file_names[z], &slice);
+        if(z == 0)
+        {
+            vol->width = slice.width;
+            vol->height = slice.height;
+            vol->depth = n;
+            vol->max_gray = slice.max_gray;
+            vol->voxels = (int *)malloc(sizeof(int) * (long long)n * slice.width * slice.height);
+            if (vol->voxels == NULL)
+            {
+                perror("Memory allocation failure");
+                exit(1);
+            }
+        }
+        else if(slice.width != vol->width || slice.height != vol->height || slice.max_gray != vol->max_gray)
+        {
+            fprintf(stderr, "Slice %s does not match the volume!\n", file_names[z]);
+            exit(1);
+        }
+        for(x=0; x<slice.width; x++)
+            memcpy(&VOXEL(vol,z,x,0), slice.pixels[x], sizeof(int) * slice.height);
+        deallocate_dynamic_matrix(slice.pixels, slice.width);
+    }
+    return vol;
+}
+
+void deallocate_volume(PGMVolume *vol)
+{
+    free(vol->voxels);
+    vol->voxels = NULL;
+}
+
+/* To add the pairs between an anchor slice and a neighbour slice
+ * Arguments: anchor, neighbour: Rows of the two slices (the same for dz = 0)
+ *            o: In-slice offset with its valid ranges
+ *            G: max gray value
+ *            C: G x G matrix to add the counts to
+ */
+void add_cooccurance_counts_slices(int **anchor, int **neighbour, GLCMOffset *o, int G, unsigned int **C)
+{
+    int x, y, a, b;
+    for(x=o->xlo; x<o->xhi; x++)
+    {
+        int *row = anchor[x];
+        int *next = neighbour[x+o->delx] + o->dely;
+        for(y=o->ylo; y<o->yhi; y++)
+        {
+            a = row[y];
+            b = next[y];
+            if((unsigned)a < (unsigned)G && (unsigned)b < (unsigned)G)
+                C[a][b]++;
+        }
+    }
+}
+
+/* To turn the 13 count matrices into 13 sets of Haralick parameters */
+void volume_counts_to_haralick(unsigned int ***C, int G, double **f)
+{
+    int k, i, j;
+    double **P = allocate_dynamic_matrix_double(G, G);
+    HaralickScratch s;
+    init_haralick_scratch(&s, G);
+    for(k=0; k<VOLUME_DIRECTIONS; k++)
+    {
+        for(i=0; i<G; i++)
+            for(j=0; j<G; j++)
+                P[i][j] = C[k][i][j];
+        calculate_haralick_parameters_scratch(P, G, f[k], &s);
+    }
+    free_haralick_scratch(&s);
+    deallocate_dynamic_matrix_double(P, G);
+}
+
+unsigned int ***allocate_volume_counts(int G)
+{
+    int k, i, j;
+    unsigned int ***C = (unsigned int ***)malloc(sizeof(unsigned int **) * VOLUME_DIRECTIONS);
+    if (C == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+    for(k=0; k<VOLUME_DIRECTIONS; k++)
+    {
+        C[k] = allocate_dynamic_matrix_uint(G, G);
+        for(i=0; i<G; i++)
+            for(j=0; j<G; j++)
+                C[k][i][j] = 0;
+    }
+    return C;
+}
+
+void deallocate_volume_counts(unsigned int ***C, int G)
+{
+    int k;
+    for(k=0; k<VOLUME_DIRECTIONS; k++)
+        deallocate_dynamic_matrix_uint(C[k], G);
+    free(C);
+}
+
+/* To find the Haralick parameters of the 13 directions of a volume in memory
+ * Arguments: vol: The volume
+ *            delta: The distance
+ *            f: 13 x 13 matrix, row k gets the parameters of volume_direction[k]
+ */
+double **create_cooccurance_matrix_volume(PGMVolume *vol, int delta, double **f)
+{
+    int k, z, x, G = vol->max_gray;
+    unsigned int ***C = allocate_volume_counts(G);
+    int **anchor = (int **)malloc(sizeof(int *) * vol->width);
+    int **neighbour = (int **)malloc(sizeof(int *) * vol->width);
+    if (anchor == NULL || neighbour == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+
+    for(k=0; k<VOLUME_DIRECTIONS; k++)
+    {
+        int dz = volume_direction[k][0]*delta;
+        GLCMOffset o = make_glcm_offset(volume_direction[k][1]*delta, volume_direction[k][2]*delta, vol->width, vol->height);
+        for(z=0; z+dz<vol->depth; z++)
+        {
+            for(x=0; x<vol->width; x++)
+            {
+                anchor[x] = &VOXEL(vol,z,x,0);
+                neighbour[x] = &VOXEL(vol,z+dz,x,0);
+            }
+            add_cooccurance_counts_slices(anchor, neighbour, &o, G, C[k]);
+        }
+    }
+
+    volume_counts_to_haralick(C, G, f);
+    free(anchor);
+    free(neighbour);
+    deallocate_volume_counts(C, G);
+    return f;
+}
+
+/* To find the Haralick parameters of the 13 directions of a volume stored as slices
+ * The slices are read one at a time into a ring of delta+1 slices; when
+ * slice z arrives its in-slice pairs and its pairs with slice z-delta are
+ * counted and slice z-delta is dropped, so memory stays at delta+1 slices
+ * however deep the volume is.
+ * Arguments: file_names: The n slices, in order
+ *            n: No of slices
+ *            delta: The distance
+ *            f: 13 x 13 matrix, row k gets the parameters of volume_direction[k]
+ */
+double **create_cooccurance_matrix_slices(const char **file_names, int n, int delta, double **f)
+{
+    int k, z, G = 0, width = 0, height = 0;
+    int ring_size = delta+1;
+    unsigned int ***C = NULL;
+    GLCMOffset o[VOLUME_DIRECTIONS];
+    PGMData slice;
+    int ***ring;
+    if (n < 1 || delta < 1)
+    {
+        fprintf(stderr, "A volume needs at least one slice and a distance of at least 1!\n");
+        exit(1);
+    }
+    ring = (int ***)malloc(sizeof(int **) * ring_size);
+    if (ring == NULL)
+    {
+        perror("Memory allocation failure");
+        exit(1);
+    }
+
+    for(z=0; z<n; z++)
+    {
+        readPGM(file_names[z], &slice);
+        if(z == 0)
+        {
+            G = slice.max_gray;
+            width = slice.width;
+            height = slice.height;
+            C = allocate_volume_counts(G);
+            for(k=0; k<VOLUME_DIRECTIONS; k++)
+                o[k] = make_glcm_offset(volume_direction[k][1]*delta, volume_direction[k][2]*delta, width, height);
+        }
+        else if(slice.width != width || slice.height != height || slice.max_gray != G)
+        {
+            fprintf(stderr, "Slice %s does not match the volume!\n", file_names[z]);
+            exit(1);
+        }
+
+        /* Slot z%ring_size held slice z-ring_size, which is no longer needed */
+        if(z >= ring_size)
+            deallocate_dynamic_matrix(ring[z%ring_size], width);
+        ring[z%ring_size] = slice.pixels;
+
+        for(k=0; k<VOLUME_DIRECTIONS; k++)
+        {
+            if(volume_direction[k][0] == 0)
+                add_cooccurance_counts_slices(slice.pixels, slice.pixels, &o[k], G, C[k]);
+            else if(z >= delta)
+                add_cooccurance_counts_slices(ring[(z-delta)%ring_size], slice.pixels, &o[k], G, C[k]);
+        }
+    }
+
+    for(z=(n>ring_size)? n-ring_size:0; z<n; z++)
+        deallocate_dynamic_matrix(ring[z%ring_size], width);
+    free(ring);
+
+    volume_counts_to_haralick(C, G, f);
+    deallocate_volume_counts(C, G);
+    return f;
+}